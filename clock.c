@@ -0,0 +1,43 @@
+/*
+  clock.c - monotonic microsecond clock
+  Part of Horus Firmware
+
+  Copyright (c) 2014-2015 Mundo Reader S.L.
+
+  Horus Firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Horus Firmware is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Horus Firmware.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "system.h"
+#include "clock.h"
+#include "laser_control.h"
+
+// CPU cycles of a Timer2 period. A whole number of microseconds in both laser timer modes.
+#define CLOCK_TICK_CYCLES ((uint32_t)(LASER_TIMER_TOP+1)*LASER_TIMER_PRESCALER)
+
+volatile uint32_t clock_ticks = 0;
+
+
+uint32_t clock_get_usec()
+{
+  uint8_t sreg = SREG;
+  cli();
+  uint32_t ticks = clock_ticks;
+  uint8_t count = TCNT2;
+  // The timer may have reached TOP and restarted since the interrupt was blocked. Count the period
+  // it is pending for, unless the timer still sits on TOP.
+  if ((TIFR2 & (1<<OCF2A)) && (count < LASER_TIMER_TOP)) { ticks++; }
+  SREG = sreg;
+  return(ticks*(CLOCK_TICK_CYCLES/TICKS_PER_MICROSECOND) +
+         ((uint32_t)count*LASER_TIMER_PRESCALER)/TICKS_PER_MICROSECOND);
+}
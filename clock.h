@@ -0,0 +1,32 @@
+/*
+  clock.h - monotonic microsecond clock
+  Part of Horus Firmware
+
+  Copyright (c) 2014-2015 Mundo Reader S.L.
+
+  Horus Firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Horus Firmware is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Horus Firmware.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef clock_h
+#define clock_h
+
+// The clock counts the periods of Timer2, which always runs for the laser control, and reads the
+// timer count within the period. Timer2 periods since power-up. Incremented by its interrupt.
+extern volatile uint32_t clock_ticks;
+
+// Returns the microseconds since power-up. Wraps around every 2^32 usec, ~71.6 minutes.
+// Safe to call with interrupts enabled or disabled.
+uint32_t clock_get_usec();
+
+#endif
@@ -52,6 +52,7 @@
 // Default cpu mappings. Grbl officially supports the Arduino Uno only. Other processor types
 // may exist from user-supplied templates or directly user-defined in cpu_map.h
 #define CPU_MAP_ATMEGA328P_HORUS // Arduino Uno CPU for Horus Project
+// #define CPU_MAP_ATMEGA2560_HORUS // Arduino Mega 2560 for Horus Project. Build with DEVICE=atmega2560.
 
 // Define runtime command special characters. These characters are 'picked-off' directly from the
 // serial read data stream and are not passed to the grbl line execution parser. Select characters
@@ -63,40 +64,54 @@
 #define CMD_FEED_HOLD '!'
 #define CMD_CYCLE_START '~'
 #define CMD_RESET 0x18 // ctrl-x.
+#define CMD_FEED_OVR_RESET 0x90         // Restores the feed override to 100%.
+#define CMD_FEED_OVR_COARSE_PLUS 0x91
+#define CMD_FEED_OVR_COARSE_MINUS 0x92
+#define CMD_FEED_OVR_FINE_PLUS 0x93
+#define CMD_FEED_OVR_FINE_MINUS 0x94
+#define CMD_LASER_ON 0x98  // 0x98-0x9B switch laser 1-4 on.
+#define CMD_LASER_OFF 0x9C // 0x9C-0x9F switch laser 1-4 off.
+
+// Feed override limits and steps, in percent of the programmed feed rates. The override scales the
+// executing and queued blocks in place, and is restored to 100% by a reset. Overrides above 100% are
+// still limited by the X axis max rate.
+#define FEED_OVERRIDE_MIN 10 // Integer (1-100)
+#define FEED_OVERRIDE_MAX 200 // Integer (100-255)
+#define FEED_OVERRIDE_COARSE_INCREMENT 10 // Integer (1-99)
+#define FEED_OVERRIDE_FINE_INCREMENT 1 // Integer (1-99)
+
+// The laser commands switch a laser within the serial receive interrupt, without waiting for the
+// line buffer, the parser or the queued motion, and send no response. They act like an M70/M71
+// executed at once, including the safety timeout, and are ignored in check mode.
+// NOTE: With LASER_MOTION_SYNC, the queued blocks leave a laser switched this way alone until the
+// next M70/M71 of that laser is parsed.
+
+// Enables the framed binary command protocol alongside the ASCII g-code parser. A packet starts with
+// the PACKET_START byte, which never exists in g-code text, and carries a command, a 32-bit value
+// and a CRC8 (see packet.h). Packet bytes are never picked off as runtime commands. Each packet is
+// answered with the same 'ok' or 'error:' status message as a g-code line.
+#define BINARY_PROTOCOL // Enabled by default. Comment to disable.
+
+// Executes the common scanner lines, G1 with X and F words and M70/M71 with a T word, in a fast path
+// ahead of the generic g-code parser, for a higher sustained line rate. Any other line, or any error,
+// goes through the full parser, with the same results.
+#define GCODE_FAST_PATH // Enabled by default. Comment to disable.
 
 // If homing is enabled, homing init lock sets Grbl into an alarm state upon power up. This forces
 // the user to perform the homing cycle (or override the locks) before doing anything else. This is
 // mainly a safety feature to remind the user to home, since position is unknown to Grbl.
 #define HOMING_INIT_LOCK // Comment to disable
 
-// Define the homing cycle patterns with bitmasks. The homing cycle first performs a search mode
-// to quickly engage the limit switches, followed by a slower locate mode, and finished by a short
-// pull-off motion to disengage the limit switches. The following HOMING_CYCLE_x defines are executed 
-// in order starting with suffix 0 and completes the homing routine for the specified-axes only. If
-// an axis is omitted from the defines, it will not home, nor will the system update its position.
-// Meaning that this allows for users with non-standard cartesian machines, such as a lathe (x then z,
-// with no y), to configure the homing cycle behavior to their needs. 
-// NOTE: The homing cycle is designed to allow sharing of limit pins, if the axes are not in the same
-// cycle, but this requires some pin settings changes in cpu_map.h file. For example, the default homing
-// cycle can share the Z limit pin with either X or Y limit pins, since they are on different cycles.
-// By sharing a pin, this frees up a precious IO pin for other purposes. In theory, all axes limit pins
-// may be reduced to one pin, if all axes are homed with seperate cycles, or vice versa, all three axes
-// on separate pin, but homed in one cycle. Also, it should be noted that the function of hard limits 
-// will not be affected by pin sharing.
-// NOTE: Defaults are set for a traditional 3-axis CNC machine. Z-axis first to clear, followed by X & Y.
-#define HOMING_CYCLE_0 (1<<Z_AXIS)                // REQUIRED: First move Z to clear workspace.
-#define HOMING_CYCLE_1 ((1<<X_AXIS)|(1<<Y_AXIS))  // OPTIONAL: Then move X,Y at the same time.
-// #define HOMING_CYCLE_2                         // OPTIONAL: Uncomment and add axes mask to enable
-
-// Number of homing cycles performed after when the machine initially jogs to limit switches.
-// This help in preventing overshoot and should improve repeatability. This value should be one or 
-// greater.
-#define N_HOMING_LOCATE_CYCLE 2 // Integer (1-128)
-
-// After homing, Grbl will set by default the entire machine space into negative space, as is typical
-// for professional CNC machines, regardless of where the limit switches are located. Uncomment this 
-// define to force Grbl to always set the machine origin at the homed location despite switch orientation.
-// #define HOMING_FORCE_SET_ORIGIN // Uncomment to enable.
+// The homing cycle '$H' locates an index sensor on the turntable, wired to the probe pin, and sets
+// the machine origin at its edge. It searches up to this travel in the $23 direction at the $25 seek
+// rate, then backs off by the $27 pull-off and re-approaches the edge at the slower $24 feed rate.
+// NOTE: When the table rests on the sensor at the start, it backs off by the pull-off first. So the
+// pull-off must be larger than the sensor flag.
+#define HOMING_SEEK_TRAVEL 370.0 // deg. One revolution plus margin.
+
+// Number of slow re-approaches of the index edge after the seek. Each one starts from the pull-off
+// of the previous trigger, which should improve repeatability. This value should be one or greater.
+#define N_HOMING_LOCATE_CYCLE 1 // Integer (1-128)
 
 // Number of blocks Grbl executes upon startup. These blocks are stored in EEPROM, where the size
 // and addresses are defined in settings.h. With the current settings, up to 2 startup blocks may
@@ -104,6 +119,12 @@
 // parser state depending on user preferences.
 #define N_STARTUP_LINE 2 // Integer (1-2)
 
+// Shortens the start after a reset, such as the DTR reset of a host reconnect. The coordinate data
+// checksums are only verified when the data is first read. '[Ready]' is sent once the startup blocks
+// have run and the main loop takes input, so the host can start at once instead of waiting a fixed
+// time.
+// #define FAST_BOOT // Default disabled. Uncomment to enable.
+
 // Number of floating decimal points printed by Grbl for certain value types. These settings are 
 // determined by realistic and commonly observed values in CNC machines. For example, position
 // values cannot be less than 0.001mm or 0.0001in, because machines can not be physically more
@@ -124,10 +145,23 @@
 // NOTE: This is experimental and doesn't quite work 100%. Maybe fixed or refactored later.
 // #define REPORT_REALTIME_RATE // Disabled by default. Uncomment to enable.
 
+// Tracks the health of the interrupts and buffers for tuning feed rates and baud settings: stepper
+// interrupt calls, entry latency and execution time in CPU cycles, interrupt overruns, segment
+// buffer underruns, planner and serial buffer high-water marks, and the main program loop time
+// between runtime checkpoints, timed by the ADC conversions of the LDR sampling (~104usec each).
+// Reported and cleared with the '$D' command. Costs a few cycles in each interrupt.
+// #define DIAGNOSTIC_COUNTERS // Default disabled. Uncomment to enable.
+
 // Upon a successful probe cycle, this option provides immediately feedback of the probe coordinates
 // through an automatically generated message. If disabled, users can still access the last probe
 // coordinates through Grbl '$#' print parameters.
 #define MESSAGE_PROBE_COORDINATES // Enabled by default. Comment to disable.
+
+// Watches the probe pin with its pin change interrupt, instead of polling it at every stepper tick.
+// The edge is timestamped as it occurs, in usec on the status report clock, and reported with the
+// probe position as 'T'. The position is latched at the edge, or by the next stepper tick when the
+// edge interrupts the position update. The stepper interrupt only checks a flag.
+#define PROBE_PIN_INTERRUPT // Enabled by default. Comment to disable.
  
 // Enables a second coolant control pin via the mist coolant g-code command M7 on the Arduino Uno
 // analog pin 5. Only use this option if you require a second coolant control pin.
@@ -153,6 +187,47 @@
 // step smoothing. See stepper.c for more details on the AMASS system works.
 #define ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING  // Default enabled. Comment to disable.
 
+// Shapes the acceleration and deceleration ramps as S-curves, so the acceleration rises and falls
+// smoothly instead of switching on and off at the ends of each ramp. This excites less wobble in
+// heavy objects on the platter, which settle sooner after a move. A ramp keeps the time and
+// distance of the trapezoid ramp, so the planner is unchanged, but the acceleration peaks at 1.5
+// times the acceleration setting in the middle of the ramp.
+// NOTE: Ramps are shaped per planner block, and restart from zero acceleration when a block is
+// replanned mid-ramp. Not supported by FIXED_POINT_PLANNER.
+// #define S_CURVE_ACCELERATION // Default disabled. Uncomment to enable.
+
+// Plans and prepares the step segments of the X axis in fixed-point integer math, in steps and step
+// rates, instead of floats in degrees. The AVR has no FPU, so this shortens the planner and segment
+// prep considerably and keeps the segment buffer well ahead of the stepper at high step rates. Only
+// the X axis moves, as in the Horus scanner, and the Y and Z targets are ignored. Junctions are
+// either straight or a full reversal, so the junction deviation setting is not used.
+// NOTE: Step rates are capped at PLAN_MAX_SPEED (46340 step/sec) and blocks at 2^24 steps.
+// #define FIXED_POINT_PLANNER // Default disabled. Uncomment to enable.
+
+// Specializes the stepper interrupt for a single axis. With only the X axis stepping, every timer
+// tick is a step, so the Bresenham line tracer and the segment block step data are dropped and
+// the interrupt runs fewer cycles per step. This raises the maximum reliable step rate of fast
+// repositioning moves. AMASS has nothing to smooth with one axis and is disabled.
+// NOTE: Requires FIXED_POINT_PLANNER, which only plans X axis motions.
+// #define SINGLE_AXIS_STEPPER // Default disabled. Uncomment to enable.
+
+// Shrinks the planner blocks to the fields of the single planned axis, from 33 to 14 bytes. The speeds
+// are kept as 16-bit step rates instead of 32-bit squares, the junction limits are derived while
+// planning, and all queued blocks share one acceleration. BLOCK_BUFFER_SIZE defaults to 40 blocks,
+// or 32 with line numbers, for more look-ahead over long runs of short moves in less RAM.
+// NOTE: Requires SINGLE_AXIS_STEPPER.
+// #define COMPACT_PLANNER_BLOCK // Default disabled. Uncomment to enable.
+
+// Looks up the CPU cycles per step of the ramp segments in a table, instead of dividing per segment.
+// The ramps change the speed by the same increment every segment, so the speeds of a ramp from rest
+// sum to whole increments and index the table exactly. Other segments interpolate between entries,
+// within 0.4%, or divide below the eighth entry and past the end of the table. The table is rebuilt
+// when the X steps/deg or acceleration setting changes, and costs 4 bytes of RAM per entry.
+// NOTE: Requires FIXED_POINT_PLANNER. A larger table covers faster ramps, up to half its size times
+// the speed increment, which is ACCELERATION_TICKS_PER_SECOND times smaller than the acceleration.
+// #define RAMP_TABLE // Default disabled. Uncomment to enable.
+#define RAMP_TABLE_SIZE 32 // Entries, 2-256. Covers about 28 deg/sec at the default acceleration.
+
 // Sets which axis the tool length offset is applied. Assumes the spindle is always parallel with 
 // the selected axis with the tool oriented toward the negative direction. In other words, a positive
 // tool length offset value is subtracted from the current location.
@@ -191,12 +266,108 @@
 // bogged down by too many trig calculations. 
 #define N_ARC_CORRECTION 12 // Integer (1-255)
 
-// Time delay increments performed during a dwell. The default value is set at 50ms, which provides
-// a maximum time delay of roughly 55 minutes, more than enough for most any application. Increasing
-// this delay will increase the maximum dwell time linearly, but also reduces the responsiveness of 
-// run-time command executions, like status reports, since these are performed between each dwell 
-// time step. Also, keep in mind that the Arduino delay timer is not very accurate for long delays.
-#define DWELL_TIME_STEP 50 // Integer (1-255) (milliseconds)
+
+// Maximum number of frames per step in an on-board scan sequence ('$S'). Each frame sets one laser
+// pattern, emits a sync marker and waits for the exposure time, before the next step is taken. The
+// pattern is stored as a short digit string, so this only costs a few bytes of stack.
+#define SCAN_MAX_FRAMES 5 // Integer (1-9)
+
+// Duration of each block queued by the continuous rotation jog ('$J') at the jog rate. The jog keeps
+// just enough of these blocks queued to cover the stopping distance, so a rate change or a stop takes
+// effect once they are done, about half the ramp time later. Shorter blocks are more to plan.
+#define JOG_BLOCK_TIME 0.1 // Float (seconds)
+
+// Safety timeout of the lasers. A laser is switched off once it has been on for this long, in case
+// the host stopped without switching it off.
+#define LASER_TIMEOUT 255 // Integer (1-2147483) (seconds)
+
+// Queues M70/M71 laser changes with the motions instead of waiting for the buffered motions to
+// complete. Each planner block carries the laser state requested when it was queued, and the stepper
+// interrupt applies it as the block starts executing, so 'G1 X0.45', 'M71 T1', 'G1 X0.9' sequences
+// keep the planner lookahead and don't stop the turntable at every laser change. Changes after the
+// last queued motion are applied when it completes, or right away when no motion is queued.
+// NOTE: With this enabled, M70/M71 return before the laser has switched. Hosts that rely on 'ok'
+// meaning the laser is already on (e.g. before triggering a camera or reading M50) must keep it
+// disabled, or issue a motion-synchronizing command first. Costs one byte per planner block.
+// #define LASER_MOTION_SYNC // Default disabled. Uncomment to enable.
+
+// Enables laser intensity control. Timer2 runs in fast PWM mode at 10kHz: the laser on the OC2B pin
+// (LASER_PWM_ID in cpu_map.h) is dimmed by the hardware PWM, the others by first-order sigma-delta
+// modulation in the Timer2 interrupt, which also ticks the software timers.
+// 'M71 T<n> S<0-255>' switches laser n on at that intensity. S defaults to 255, continuously on.
+// With CAMERA_TRIGGER also enabled, 'M71 T<n> P<ms>' sets strobe mode: the laser is only lit for
+// P milliseconds after each camera trigger pulse, so it is on just for the exposure window. P
+// defaults to 0, continuous. Intensity and strobe window take effect right away, even when the
+// switching itself is queued with LASER_MOTION_SYNC.
+// NOTE: The Timer2 interrupt runs every 100us, costing a few percent of CPU time. Software PWM
+// lasers toggle at up to 5kHz, so exposures should be at least ~2ms for an even average.
+// #define LASER_PWM // Default disabled. Uncomment to enable.
+
+// Enables timed laser pulses. 'M72 T<n> P<ms>' waits for the buffered motions to complete, lights
+// laser n for P milliseconds and returns once it is off again. 'L<m>' lights laser m for as long
+// right after it, back-to-back, such as for one frame of each laser. The pulse is ended by a
+// Timer2 compare interrupt, to 4us. With LASER_PWM it is timed in the 100us PWM periods instead.
+// #define LASER_PULSE // Default disabled. Uncomment to enable.
+
+// Enables the hardware camera trigger output on TRIGGER_BIT (see cpu_map.h). The trigger pin is
+// pulsed by the stepper interrupt together with the step pulse that completes a planner block, or,
+// when the trigger step interval setting ($30) is non-zero, on every that many steps of a motion.
+// The pulse has the same width as the step pulse ($0), so frame capture can be hardware-locked to
+// the turntable angle instead of waiting on serial acks.
+// #define CAMERA_TRIGGER // Default disabled. Uncomment to enable.
+
+// Enables the sync bus, which starts the motions of several units in lockstep on a shared signal
+// (SYNC_IN and SYNC_OUT pins in cpu_map.h). 'M73' waits for the buffered motions to complete, then
+// raises the sync output and holds the motions that follow until a falling edge on the sync input.
+// The edge starts them from the pin change interrupt and lowers the output again. '$S...W1' does
+// the same before every step of the scan. A cycle start '~' also releases the held motions.
+// #define SYNC_BUS // Default disabled. Uncomment to enable.
+
+// Analog sensor (LDR) acquisition. The ADC interrupt samples the channels set in LDR_CHANNEL_MASK
+// round-robin in the background, so M50 returns the latest filtered value right away instead of
+// stalling the main program on a conversion. Each reading sums 2^LDR_OVERSAMPLE samples of one
+// channel and decimates the sum to 10+LDR_EXTRA_BITS bits. M50 returns the average of the last
+// LDR_FILTER_SIZE readings of the channel. Only channels in the mask can be read with M50.
+// NOTE: At the /128 ADC clock, one conversion takes 104us. With the defaults, a channel gets a new
+// reading every 16 samples, or ~7ms with 4 channels. LDR_EXTRA_BITS must not exceed LDR_OVERSAMPLE/2,
+// and the default of 0 keeps the 0-1023 M50 range. Each filter entry costs 2 bytes per channel.
+#define LDR_CHANNEL_MASK 0x0F // Analog pins A0-A3. Bit n enables ADC channel n (0-7).
+#define LDR_OVERSAMPLE 4 // Integer (0-6). Samples per reading as a power of two.
+#define LDR_EXTRA_BITS 0 // Integer (0-3). Extra resolution bits from oversampling.
+#define LDR_FILTER_SIZE 4 // Integer (1-16). Readings averaged per M50 value.
+
+// Enables angle-synchronous LDR streaming with 'M51 T<channel> P<interval>'. While streaming, the
+// stepper interrupt latches the latest reading of the channel every P degrees of rotation, tagged
+// with the machine position in steps, and the main program pushes each record to the host as
+// '[L:<steps>,<value>]' without being polled. 'M51' or 'M51 P0' stops it. Both wait for the buffered
+// motions to complete, so a 'M51 T0 P0.45', 'G1 X360', 'M51' sequence samples one full revolution.
+// NOTE: Records are only written while the serial TX buffer has room for a whole one, so streaming
+// never blocks the main program. If the host can't keep up, the record buffer fills and samples are
+// dropped, which shows as a gap in the positions. For the shortest latency, sample only the
+// streamed channel in LDR_CHANNEL_MASK. Each record costs 6 bytes of RAM.
+// #define LDR_STREAMING // Default disabled. Uncomment to enable.
+#define LDR_STREAM_BUFFER_SIZE 8 // Integer (2-255). Records waiting to be sent.
+
+// Queues M50 reads with the motions, instead of printing the value at once. Each read is taken when
+// the motions queued before it have completed, and sent on its own as '[R:<tag>,<value>]'. The tag
+// is the N line number of the M50 line, such as 'N12 M50 T0', or without N the count of M50 reads
+// since reset. So the host can keep moves and reads in flight and match the readings by their tag.
+// An M50 waits while LDR_READ_QUEUE_SIZE-1 reads are still pending.
+// NOTE: Only LASER_MOTION_SYNC keeps the moves in flight, since otherwise every g-code line waits
+// for the buffered motions to complete. Costs one byte per planner block.
+// #define LDR_READ_QUEUE // Default disabled. Uncomment to enable.
+#define LDR_READ_QUEUE_SIZE 8 // Integer (2-255). Reads queued or waiting to be sent.
+
+// Enables a step trace. The stepper interrupt records the time and machine position of every step
+// pulse, or with STEP_TRACE_SEGMENTS of every segment start, in a ring that keeps the latest
+// STEP_TRACE_SIZE records. '$T' sends them when idle as '[T:<time>,<steps>]' and clears the trace.
+// Times are CPU cycles on the stepper clock, which sums the ISR tick periods plus the latency of
+// each interrupt, so the ramps and any jitter show as they reached the pins.
+// NOTE: The stepper clock only runs while moving. It wraps every 2^32 cycles, 268 sec at 16MHz.
+// Each record costs 8 bytes of RAM.
+// #define STEP_TRACE // Default disabled. Uncomment to enable.
+// #define STEP_TRACE_SEGMENTS // Default disabled. Uncomment to record segments instead of steps.
+#define STEP_TRACE_SIZE 32 // Integer (1-255). Records kept.
 
 // Creates a delay between the direction pin setting and corresponding step pulse by creating
 // another interrupt (Timer2 compare) to manage it. The main Grbl interrupt (Timer1 compare) 
@@ -274,6 +445,36 @@
 // #error Parameters ACCELERATION_TICKS / ISR_TICKS must be < 256 to prevent integer overflow.
 // #endif
 
+#ifdef SINGLE_AXIS_STEPPER
+  #ifndef FIXED_POINT_PLANNER
+    #error "SINGLE_AXIS_STEPPER requires FIXED_POINT_PLANNER."
+  #endif
+  #undef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING // Nothing to smooth with a single axis.
+#endif
+
+#ifdef S_CURVE_ACCELERATION
+  #ifdef FIXED_POINT_PLANNER
+    #error "S_CURVE_ACCELERATION is not supported by FIXED_POINT_PLANNER."
+  #endif
+#endif
+
+#ifdef RAMP_TABLE
+  #ifndef FIXED_POINT_PLANNER
+    #error "RAMP_TABLE requires FIXED_POINT_PLANNER."
+  #endif
+#endif
+
+#ifdef COMPACT_PLANNER_BLOCK
+  #ifndef SINGLE_AXIS_STEPPER
+    #error "COMPACT_PLANNER_BLOCK requires SINGLE_AXIS_STEPPER."
+  #endif
+#endif
+
+// The software timers compare signed millisecond differences.
+#if (LASER_TIMEOUT < 1) || (LASER_TIMEOUT > 2147483)
+  #error "LASER_TIMEOUT must be 1-2147483 seconds."
+#endif
+
 // ---------------------------------------------------------------------------------------
 
 
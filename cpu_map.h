@@ -49,6 +49,8 @@
   #define LASER3_BIT      4  // Uno Digital Pin 4
   #define LASER4_BIT      5  // Uno Digital Pin 5
   #define LASER_MASK      ((1<<LASER1_BIT)|(1<<LASER2_BIT)|(1<<LASER3_BIT)|(1<<LASER4_BIT)) // All step bits
+  #define N_LASER         4  // Number of laser outputs
+  #define LASER_PWM_ID    1  // Laser on the Timer2 OC2B pin (LASER2_BIT), hardware PWM with LASER_PWM
 
   // Define step pulse output pins. NOTE: All step bit pins must be on the same port.
   #define STEP_DDR        DDRB
@@ -68,15 +70,118 @@
   #define STEPPERS_DISABLE_BIT    1  // Uno Digital Pin 9
   #define STEPPERS_DISABLE_MASK   (1<<STEPPERS_DISABLE_BIT)
 
+  // Define camera trigger output pin. Only used when CAMERA_TRIGGER is enabled in config.h.
+  #define TRIGGER_DDR     DDRB
+  #define TRIGGER_PORT    PORTB
+  #define TRIGGER_BIT     0  // Uno Digital Pin 8
+  #define TRIGGER_MASK    (1<<TRIGGER_BIT)
+
   // Define probe switch input pin.
   #define PROBE_DDR       DDRC
   #define PROBE_PIN       PINC
   #define PROBE_PORT      PORTC
   #define PROBE_BIT       5  // Uno Analog Pin 5
   #define PROBE_MASK      (1<<PROBE_BIT)
+  #define PROBE_INT       PCIE1  // Pin change interrupt enable pin
+  #define PROBE_INT_vect  PCINT1_vect
+  #define PROBE_PCMSK     PCMSK1 // Pin change interrupt register
+
+  // Define sync bus pins. Only used when SYNC_BUS is enabled in config.h. The input needs its own
+  // pin change interrupt, apart from the probe.
+  #define SYNC_IN_DDR     DDRD
+  #define SYNC_IN_PIN     PIND
+  #define SYNC_IN_PORT    PORTD
+  #define SYNC_IN_BIT     7  // Uno Digital Pin 7
+  #define SYNC_IN_MASK    (1<<SYNC_IN_BIT)
+  #define SYNC_INT        PCIE2  // Pin change interrupt enable pin
+  #define SYNC_INT_vect   PCINT2_vect
+  #define SYNC_PCMSK      PCMSK2 // Pin change interrupt register
+  #define SYNC_OUT_DDR    DDRC
+  #define SYNC_OUT_PORT   PORTC
+  #define SYNC_OUT_BIT    4  // Uno Analog Pin 4
+  #define SYNC_OUT_MASK   (1<<SYNC_OUT_BIT)
 
 #endif
 
+//----------------------------------------------------------------------------------------
+
+#ifdef CPU_MAP_ATMEGA2560_HORUS // Arduino Mega 2560 for Horus Project
+
+  // Serial port pins
+  #define SERIAL_RX USART0_RX_vect
+  #define SERIAL_UDRE USART0_UDRE_vect
+
+  // Increase buffers to make use of the 8KB of SRAM. The serial buffers are indexed by a byte,
+  // so 255 is the largest size.
+  #define RX_BUFFER_SIZE      255
+  #define TX_BUFFER_SIZE      128
+  #define BLOCK_BUFFER_SIZE   36
+  #define LINE_BUFFER_SIZE    128
+
+  // Define laser pulse output pins. NOTE: All laser pins must be on the same port.
+  #define LASER_DDR       DDRH
+  #define LASER_PORT      PORTH
+  #define LASER1_BIT      3  // MEGA2560 Digital Pin 6
+  #define LASER2_BIT      4  // MEGA2560 Digital Pin 7
+  #define LASER3_BIT      5  // MEGA2560 Digital Pin 8
+  #define LASER4_BIT      6  // MEGA2560 Digital Pin 9
+  #define LASER_MASK      ((1<<LASER1_BIT)|(1<<LASER2_BIT)|(1<<LASER3_BIT)|(1<<LASER4_BIT)) // All step bits
+  #define N_LASER         4  // Number of laser outputs
+  #define LASER_PWM_ID    3  // Laser on the Timer2 OC2B pin (LASER4_BIT), hardware PWM with LASER_PWM
+
+  // Define step pulse output pins. NOTE: All step bit pins must be on the same port.
+  #define STEP_DDR        DDRB
+  #define STEP_PORT       PORTB
+  #define X_STEP_BIT      6  // MEGA2560 Digital Pin 12
+  #define STEP_MASK       (1<<X_STEP_BIT) // All step bits
+
+  // Define step direction output pins. NOTE: All direction pins must be on the same port.
+  #define DIRECTION_DDR     DDRB
+  #define DIRECTION_PORT    PORTB
+  #define X_DIRECTION_BIT   7  // MEGA2560 Digital Pin 13
+  #define DIRECTION_MASK    (1<<X_DIRECTION_BIT) // All direction bits
+
+  // Define stepper driver enable/disable output pin.
+  #define STEPPERS_DISABLE_DDR    DDRB
+  #define STEPPERS_DISABLE_PORT   PORTB
+  #define STEPPERS_DISABLE_BIT    5  // MEGA2560 Digital Pin 11
+  #define STEPPERS_DISABLE_MASK   (1<<STEPPERS_DISABLE_BIT)
+
+  // Define camera trigger output pin. Only used when CAMERA_TRIGGER is enabled in config.h.
+  #define TRIGGER_DDR     DDRB
+  #define TRIGGER_PORT    PORTB
+  #define TRIGGER_BIT     4  // MEGA2560 Digital Pin 10
+  #define TRIGGER_MASK    (1<<TRIGGER_BIT)
+
+  // Define probe switch input pin. Port F of the analog pins 0-7 has no pin change interrupt.
+  #define PROBE_DDR       DDRK
+  #define PROBE_PIN       PINK
+  #define PROBE_PORT      PORTK
+  #define PROBE_BIT       0  // MEGA2560 Analog Pin 8
+  #define PROBE_MASK      (1<<PROBE_BIT)
+  #define PROBE_INT       PCIE2  // Pin change interrupt enable pin
+  #define PROBE_INT_vect  PCINT2_vect
+  #define PROBE_PCMSK     PCMSK2 // Pin change interrupt register
+
+  // Define sync bus pins. Only used when SYNC_BUS is enabled in config.h. The input needs its own
+  // pin change interrupt, apart from the probe.
+  #define SYNC_IN_DDR     DDRB
+  #define SYNC_IN_PIN     PINB
+  #define SYNC_IN_PORT    PORTB
+  #define SYNC_IN_BIT     0  // MEGA2560 Digital Pin 53
+  #define SYNC_IN_MASK    (1<<SYNC_IN_BIT)
+  #define SYNC_INT        PCIE0  // Pin change interrupt enable pin
+  #define SYNC_INT_vect   PCINT0_vect
+  #define SYNC_PCMSK      PCMSK0 // Pin change interrupt register
+  #define SYNC_OUT_DDR    DDRL
+  #define SYNC_OUT_PORT   PORTL
+  #define SYNC_OUT_BIT    0  // MEGA2560 Digital Pin 49
+  #define SYNC_OUT_MASK   (1<<SYNC_OUT_BIT)
+
+#endif
+
+//----------------------------------------------------------------------------------------
+
 #ifdef CPU_MAP_ATMEGA328P // (Arduino Uno) Officially supported by Grbl.
 
   // Define serial port pins and interrupt vectors.
@@ -165,6 +270,9 @@
   #define PROBE_PORT      PORTC
   #define PROBE_BIT       5  // Uno Analog Pin 5
   #define PROBE_MASK      (1<<PROBE_BIT)
+  #define PROBE_INT       PCIE1  // Pin change interrupt enable pin
+  #define PROBE_INT_vect  PCINT1_vect
+  #define PROBE_PCMSK     PCMSK1 // Pin change interrupt register
 
   
   #ifdef VARIABLE_SPINDLE
@@ -276,6 +384,9 @@
   #define PROBE_PORT      PORTK
   #define PROBE_BIT       3  // MEGA2560 Analog Pin 11
   #define PROBE_MASK      (1<<PROBE_BIT)
+  #define PROBE_INT       PCIE2  // Pin change interrupt enable pin
+  #define PROBE_INT_vect  PCINT2_vect
+  #define PROBE_PCMSK     PCMSK2 // Pin change interrupt register
 
   // Start of PWM & Stepper Enabled Spindle
   #ifdef VARIABLE_SPINDLE
@@ -61,10 +61,20 @@
   #define DEFAULT_HARD_LIMIT_ENABLE 0  // false
   #define DEFAULT_HOMING_ENABLE 0  // false
   #define DEFAULT_HOMING_DIR_MASK 0 // move positive dir
-  #define DEFAULT_HOMING_FEED_RATE 25.0 // mm/min
-  #define DEFAULT_HOMING_SEEK_RATE 500.0 // mm/min
-  #define DEFAULT_HOMING_DEBOUNCE_DELAY 250 // msec (0-65k)
-  #define DEFAULT_HOMING_PULLOFF 1.0 // mm
+  #define DEFAULT_HOMING_FEED_RATE (5.0*60) // 5*60 deg/min = 5 deg/sec
+  #define DEFAULT_HOMING_SEEK_RATE (90.0*60) // 90*60 deg/min = 90 deg/sec
+  #define DEFAULT_HOMING_DEBOUNCE_DELAY 100 // msec (0-65k)
+  #define DEFAULT_HOMING_PULLOFF 5.0 // deg
+  #define DEFAULT_TRIGGER_STEP_INTERVAL 0 // steps (0 triggers at end of each block)
+  #define DEFAULT_STATUS_REPORT_INTERVAL 0 // msec (0 reports on request only)
+  #define DEFAULT_BAUD_RATE BAUD_RATE // bps
+  #define DEFAULT_RX_CREDIT_REPORT 0 // false
+  #ifdef BTENABLED
+    #define DEFAULT_TERSE_RESPONSES 1 // true
+  #else
+    #define DEFAULT_TERSE_RESPONSES 0 // false
+  #endif
+  #define DEFAULT_ACK_LINES 0 // lines (0 acks every line)
 #endif
 
 #ifdef DEFAULTS_GENERIC
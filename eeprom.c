@@ -23,6 +23,7 @@
 ****************************************************************************/
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include "eeprom.h"
 
 /* These EEPROM bits have different names on different devices. */
 #ifndef EEPE
@@ -37,54 +38,37 @@
 /* Define to reduce code size. */
 #define EEPROM_IGNORE_SELFPROG //!< Remove SPM flag polling.
 
-/*! \brief  Read byte from EEPROM.
- *
- *  This function reads one byte from a given EEPROM address.
- *
- *  \note  The CPU is halted for 4 clock cycles during EEPROM read.
- *
- *  \param  addr  EEPROM address to read from.
- *  \return  The byte read from the EEPROM address.
- */
-unsigned char eeprom_get_char( unsigned int addr )
-{
-	do {} while( EECR & (1<<EEPE) ); // Wait for completion of previous write.
-	EEAR = addr; // Set EEPROM address register.
-	EECR = (1<<EERE); // Start EEPROM read operation.
-	return EEDR; // Return the byte read from EEPROM.
-}
+/* Write-behind queue. Writes are serviced by the EEPROM ready interrupt in order, so the main
+ * program does not wait ~3.4ms per byte. The interrupt skips the bytes that already hold the
+ * queued value without programming them. */
+static unsigned int eeprom_queue_addr[EEPROM_QUEUE_SIZE];
+static unsigned char eeprom_queue_data[EEPROM_QUEUE_SIZE];
+static volatile uint8_t eeprom_queue_head = 0; // Next entry to be queued
+static volatile uint8_t eeprom_queue_tail = 0; // Next entry to be written
 
-/*! \brief  Write byte to EEPROM.
- *
- *  This function writes one byte to a given EEPROM address.
- *  The differences between the existing byte and the new value is used
- *  to select the most efficient EEPROM programming mode.
+/*! \brief  Program byte to EEPROM.
  *
- *  \note  The CPU is halted for 2 clock cycles during EEPROM programming.
+ *  Starts programming a byte at the address set in EEAR. The differences
+ *  between the existing byte and the new value is used to select the most
+ *  efficient EEPROM programming mode. Nothing is programmed when they are
+ *  equal.
  *
- *  \note  When this function returns, the new EEPROM value is not available
- *         until the EEPROM programming time has passed. The EEPE bit in EECR
- *         should be polled to check whether the programming is finished.
+ *  \note  Must be called with interrupts disabled and no programming in
+ *         progress. Keeps the ready interrupt enabled.
  *
- *  \note  The EEPROM_GetChar() function checks the EEPE bit automatically.
- *
- *  \param  addr  EEPROM address to write to.
  *  \param  new_value  New EEPROM value.
+ *  \return  True if programming was started.
  */
-void eeprom_put_char( unsigned int addr, unsigned char new_value )
+static unsigned char eeprom_program( unsigned char new_value )
 {
 	char old_value; // Old EEPROM value.
 	char diff_mask; // Difference mask, i.e. old value XOR new value.
 
-	cli(); // Ensure atomic operation for the write operation.
-	
-	do {} while( EECR & (1<<EEPE) ); // Wait for completion of previous write.
 	#ifndef EEPROM_IGNORE_SELFPROG
 	do {} while( SPMCSR & (1<<SELFPRGEN) ); // Wait for completion of SPM.
 	#endif
 	
-	EEAR = addr; // Set EEPROM address register.
-	EECR = (1<<EERE); // Start EEPROM read operation.
+	EECR |= (1<<EERE); // Start EEPROM read operation.
 	old_value = EEDR; // Get old EEPROM value.
 	diff_mask = old_value ^ new_value; // Get bit differences.
 	
@@ -97,36 +81,142 @@ void eeprom_put_char( unsigned int addr, unsigned char new_value )
 			// Now we know that some bits need to be programmed to '0' also.
 			
 			EEDR = new_value; // Set EEPROM data register.
-			EECR = (1<<EEMPE) | // Set Master Write Enable bit...
+			EECR = (EECR & (1<<EERIE)) | // Keep the ready interrupt...
+			       (1<<EEMPE) | // Set Master Write Enable bit...
 			       (0<<EEPM1) | (0<<EEPM0); // ...and Erase+Write mode.
 			EECR |= (1<<EEPE);  // Start Erase+Write operation.
 		} else {
 			// Now we know that all bits should be erased.
 
-			EECR = (1<<EEMPE) | // Set Master Write Enable bit...
+			EECR = (EECR & (1<<EERIE)) | // Keep the ready interrupt...
+			       (1<<EEMPE) | // Set Master Write Enable bit...
 			       (1<<EEPM0);  // ...and Erase-only mode.
 			EECR |= (1<<EEPE);  // Start Erase-only operation.
 		}
-	} else {
-		// Now we know that _no_ bits need to be erased to '1'.
+		return 1;
+	}
+	
+	// Now we know that _no_ bits need to be erased to '1'.
+	
+	// Check if any bits are changed from '1' in the old value.
+	if( diff_mask ) {
+		// Now we know that _some_ bits need to the programmed to '0'.
 		
-		// Check if any bits are changed from '1' in the old value.
-		if( diff_mask ) {
-			// Now we know that _some_ bits need to the programmed to '0'.
-			
-			EEDR = new_value;   // Set EEPROM data register.
-			EECR = (1<<EEMPE) | // Set Master Write Enable bit...
-			       (1<<EEPM1);  // ...and Write-only mode.
-			EECR |= (1<<EEPE);  // Start Write-only operation.
+		EEDR = new_value;   // Set EEPROM data register.
+		EECR = (EECR & (1<<EERIE)) | // Keep the ready interrupt...
+		       (1<<EEMPE) | // Set Master Write Enable bit...
+		       (1<<EEPM1);  // ...and Write-only mode.
+		EECR |= (1<<EEPE);  // Start Write-only operation.
+		return 1;
+	}
+	return 0;
+}
+
+/*! \brief  Service the write queue.
+ *
+ *  Starts programming the next queued byte that differs from the EEPROM
+ *  content. Disables the ready interrupt when the queue runs empty.
+ *
+ *  \note  Must be called with interrupts disabled and no programming in
+ *         progress.
+ */
+static void eeprom_service( void )
+{
+	uint8_t tail = eeprom_queue_tail;
+	while( tail != eeprom_queue_head ) {
+		EEAR = eeprom_queue_addr[tail]; // Set EEPROM address register.
+		unsigned char started = eeprom_program( eeprom_queue_data[tail] );
+		if( ++tail == EEPROM_QUEUE_SIZE ) { tail = 0; }
+		if( started ) {
+			eeprom_queue_tail = tail;
+			return;
 		}
 	}
-	
-	sei(); // Restore interrupt flag state.
+	eeprom_queue_tail = tail;
+	EECR &= ~(1<<EERIE); // Queue empty. Disable the ready interrupt.
 }
 
-// Extensions added as part of Grbl 
+/*! \brief  EEPROM ready interrupt.
+ *
+ *  Fires while the ready interrupt is enabled and no programming is in
+ *  progress, so each completed write starts the next queued one.
+ */
+ISR(EE_READY_vect)
+{
+	eeprom_service();
+}
+
+/*! \brief  Read byte from EEPROM.
+ *
+ *  This function reads one byte from a given EEPROM address. A queued
+ *  write to the address is returned instead, as it is newer than the
+ *  EEPROM content.
+ *
+ *  \note  The CPU is halted for 4 clock cycles during EEPROM read, and
+ *         waits for a write in progress to complete.
+ *
+ *  \param  addr  EEPROM address to read from.
+ *  \return  The byte read from the EEPROM address.
+ */
+unsigned char eeprom_get_char( unsigned int addr )
+{
+	unsigned char value;
+	uint8_t sreg = SREG;
+	cli(); // Keep the queue and the EEPROM registers from the ready interrupt.
+
+	// Search the queue from the newest entry.
+	uint8_t index = eeprom_queue_head;
+	while( index != eeprom_queue_tail ) {
+		if( index == 0 ) { index = EEPROM_QUEUE_SIZE; }
+		index--;
+		if( eeprom_queue_addr[index] == addr ) {
+			value = eeprom_queue_data[index];
+			SREG = sreg;
+			return value;
+		}
+	}
+
+	do {} while( EECR & (1<<EEPE) ); // Wait for completion of previous write.
+	EEAR = addr; // Set EEPROM address register.
+	EECR |= (1<<EERE); // Start EEPROM read operation.
+	value = EEDR; // Get the byte read from EEPROM.
+	SREG = sreg;
+	return value;
+}
 
+/*! \brief  Write byte to EEPROM.
+ *
+ *  This function queues one byte to be written to a given EEPROM address,
+ *  and returns without waiting for the EEPROM programming time. Queued
+ *  bytes are written in order.
+ *
+ *  \note  When the queue is full, it waits for the writes in progress and
+ *         services the queue itself, as with synchronous writes.
+ *
+ *  \param  addr  EEPROM address to write to.
+ *  \param  new_value  New EEPROM value.
+ */
+void eeprom_put_char( unsigned int addr, unsigned char new_value )
+{
+	uint8_t next_head = eeprom_queue_head+1;
+	if( next_head == EEPROM_QUEUE_SIZE ) { next_head = 0; }
+
+	while( next_head == eeprom_queue_tail ) {
+		uint8_t sreg = SREG;
+		cli();
+		if( !(EECR & (1<<EEPE)) ) { eeprom_service(); } // Free an entry with the next write.
+		SREG = sreg;
+	}
+
+	eeprom_queue_addr[eeprom_queue_head] = addr;
+	eeprom_queue_data[eeprom_queue_head] = new_value;
+	eeprom_queue_head = next_head;
+	EECR |= (1<<EERIE); // The ready interrupt writes it.
+}
+
+// Extensions added as part of Grbl 
 
+// NOTE: The checksum is queued after all the data, so it is only valid once the whole copy is written.
 void memcpy_to_eeprom_with_checksum(unsigned int destination, char *source, unsigned int size) {
   unsigned char checksum = 0;
   for(; size > 0; size--) { 
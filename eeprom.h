@@ -26,6 +26,11 @@
 #ifndef eeprom_h
 #define eeprom_h
 
+// Number of queued EEPROM writes. A write beyond it waits for the oldest one to be programmed.
+#ifndef EEPROM_QUEUE_SIZE
+  #define EEPROM_QUEUE_SIZE 32
+#endif
+
 unsigned char eeprom_get_char(unsigned int addr);
 void eeprom_put_char(unsigned int addr, unsigned char new_value);
 void memcpy_to_eeprom_with_checksum(unsigned int destination, char *source, unsigned int size);
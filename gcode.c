@@ -31,6 +31,7 @@
 #include "motion_control.h"
 #include "probe.h"
 #include "report.h"
+#include "laser_control.h"
 
 // NOTE: Max line number is defined by the g-code standard to be 99999. It seems to be an
 // arbitrary value, and some GUIs may require more. So we increased it based on a max safe
@@ -55,7 +56,7 @@ void gc_init()
   
   // Load default G54 coordinate system.
   if (!(settings_read_coord_data(gc_state.modal.coord_select,gc_state.coord_system))) { 
-    report_status_message(STATUS_SETTING_READ_FAIL); 
+    report_unsolicited_status(STATUS_SETTING_READ_FAIL); 
   } 
 }
 
@@ -79,6 +80,109 @@ static uint8_t gc_check_same_position(float *pos_a, float *pos_b)
   }
   return(true);
 }
+
+
+// Enables or disables the stepper motor. Every block sets the motor to its modal state.
+static void gc_run_motor(uint8_t motor)
+{
+  if (motor == MOTOR_ENABLE) {
+    st_disable_on_idle(false);
+    st_wake_up();
+  }
+  else {
+    st_disable_on_idle(true);
+    st_go_idle();
+  }
+}
+
+
+#ifdef GCODE_FAST_PATH
+// Returned by gc_execute_fast_line() for a line the full parser must handle.
+#define GC_FAST_PATH_MISS 0xFF
+
+// Executes the common scanner lines without the generic parser: a linear move with X and F
+// words "[G1]X<deg>F<deg/sec>", in any order and each optional, and a laser switch "M70T<n>" or
+// "M71T<n>". The parser state and actions are the same as gc_execute_line() makes for them.
+// Returns GC_FAST_PATH_MISS, before changing any state, for any other line or value error, or
+// when the modes differ from the G94 G21 G90 defaults. The full parser then handles the line.
+static uint8_t gc_execute_fast_line(char *line)
+{
+  if ((gc_state.modal.feed_rate != FEED_RATE_MODE_UNITS_PER_MIN) || (gc_state.modal.units != UNITS_MODE_MM) ||
+      (gc_state.modal.distance != DISTANCE_MODE_ABSOLUTE)) { return(GC_FAST_PATH_MISS); }
+
+  uint8_t char_counter = 0;
+  float value;
+
+  // [M70/M71 T<n>]: Laser switch. The feed rate is pushed through the block as the full parser does.
+  if (line[0] == 'M') {
+    if ((line[1] != '7') || ((line[2] != '0') && (line[2] != '1')) || (line[3] != 'T')) { return(GC_FAST_PATH_MISS); }
+    char_counter = 4;
+    if (!read_float(line, &char_counter, &value) || (line[char_counter] != 0)) { return(GC_FAST_PATH_MISS); }
+    if (value < 0.0) { return(GC_FAST_PATH_MISS); }
+    uint8_t tool = trunc(value);
+    uint8_t laser = (line[2] == '1') ? LASER_ENABLE : LASER_DISABLE;
+
+    gc_state.feed_rate = (gc_state.feed_rate/60)*60;
+    gc_state.tool = tool;
+    gc_state.modal.laser = laser;
+    laser_run(tool, laser);
+    #ifdef LASER_PWM
+      if (laser == LASER_ENABLE) {
+        laser_set_intensity(tool-1, 255);
+        #ifdef CAMERA_TRIGGER
+          laser_set_strobe(tool-1, 0);
+        #endif
+      }
+    #endif
+    gc_run_motor(gc_state.modal.motor);
+    return(STATUS_OK);
+  }
+
+  // [G1 X<deg> F<deg/sec>]: Linear move. Without G1, X moves in the modal motion, which must be G1.
+  uint8_t motion_command = false;
+  if ((line[0] == 'G') && (line[1] == '1') && ((line[2] == 'X') || (line[2] == 'F') || (line[2] == 0))) {
+    motion_command = true;
+    char_counter = 2;
+  }
+  uint16_t words = 0;
+  float x = 0.0, f = 0.0;
+  while (line[char_counter] != 0) {
+    char letter = line[char_counter++];
+    if (!read_float(line, &char_counter, &value)) { return(GC_FAST_PATH_MISS); }
+    if ((letter == 'X') && !(words & bit(WORD_X))) { x = value; words |= bit(WORD_X); }
+    else if ((letter == 'F') && !(words & bit(WORD_F)) && (value >= 0.0)) { f = value; words |= bit(WORD_F); }
+    else { return(GC_FAST_PATH_MISS); }
+  }
+  if (!(words & bit(WORD_F))) { f = gc_state.feed_rate/60; } // Push last state feed rate.
+  if (words & bit(WORD_X)) {
+    if (!motion_command && (gc_state.modal.motion != MOTION_MODE_LINEAR)) { return(GC_FAST_PATH_MISS); }
+    motion_command = true;
+  }
+  if (motion_command && (f == 0.0)) { return(GC_FAST_PATH_MISS); } // [Feed rate undefined]
+
+  gc_state.feed_rate = f*60;
+  gc_state.tool = 0;
+  if (motion_command) {
+    gc_state.modal.motion = MOTION_MODE_LINEAR;
+    if (words & bit(WORD_X)) {
+      float target[N_AXIS];
+      memcpy(target, gc_state.position, sizeof(target));
+      target[X_AXIS] = x;
+      target[X_AXIS] += gc_state.coord_system[X_AXIS] + gc_state.coord_offset[X_AXIS];
+      if (TOOL_LENGTH_OFFSET_AXIS == X_AXIS) { target[X_AXIS] += gc_state.tool_length_offset; }
+      #ifdef USE_LINE_NUMBERS
+        mc_line(target, gc_state.feed_rate, gc_state.modal.feed_rate, 0);
+      #else
+        mc_line(target, gc_state.feed_rate, gc_state.modal.feed_rate);
+      #endif
+      memcpy(gc_state.position, target, sizeof(target));
+    }
+  }
+  laser_run(0, gc_state.modal.laser); // As for every block without a T word.
+  gc_run_motor(gc_state.modal.motor);
+  return(STATUS_OK);
+}
+#endif
          
 // Executes one line of 0-terminated G-Code. The line is assumed to contain only uppercase
 // characters and signed floating point values (no whitespace). Comments and block delete
@@ -87,6 +191,11 @@ static uint8_t gc_check_same_position(float *pos_a, float *pos_b)
 // coordinates, respectively.
 uint8_t gc_execute_line(char *line) 
 {
+  #ifdef GCODE_FAST_PATH
+    uint8_t status = gc_execute_fast_line(line);
+    if (status != GC_FAST_PATH_MISS) { return(status); }
+  #endif
+
   /* -------------------------------------------------------------------------------------
      STEP 1: Initialize parser block struct and copy current g-code state modes. The parser
      updates these modes and commands as the block line is parser and will only be used and
@@ -97,6 +206,15 @@ uint8_t gc_execute_line(char *line)
   memset(&gc_block, 0, sizeof(gc_block)); // Initialize the parser block struct.
   memcpy(&gc_block.modal,&gc_state.modal,sizeof(gc_modal_t)); // Copy current modes
   uint8_t axis_command = AXIS_COMMAND_NONE;
+  #if defined(LASER_PWM) || defined(LASER_PULSE)
+    uint8_t laser_command = false; // Tracks an M70/M71 command in the block
+  #endif
+  #ifdef LASER_PULSE
+    uint8_t laser_pulse = false; // Tracks an M72 command in the block
+  #endif
+  #ifdef SYNC_BUS
+    uint8_t sync_point = false; // Tracks an M73 command in the block
+  #endif
   uint8_t axis_0, axis_1, axis_linear;
   uint8_t coord_select = 0; // Tracks G10 P coordinate selection for execution
   float coordinate_data[N_AXIS]; // Multi-use variable to store coordinate data for execution
@@ -183,8 +301,21 @@ uint8_t gc_execute_line(char *line)
           case 17: gc_block.modal.motor = MOTOR_ENABLE; break;
           case 18: gc_block.modal.motor = MOTOR_DISABLE; break;
           case 50: gc_block.modal.ldr = LDR_READ; break;
-          case 70: gc_block.modal.laser = LASER_DISABLE; break;
-          case 71: gc_block.modal.laser = LASER_ENABLE; break;
+          #ifdef LDR_STREAMING
+            case 51: gc_block.modal.ldr = LDR_STREAM; break;
+          #endif
+          case 70: case 71:
+            gc_block.modal.laser = (int_value == 71) ? LASER_ENABLE : LASER_DISABLE;
+            #if defined(LASER_PWM) || defined(LASER_PULSE)
+              laser_command = true;
+            #endif
+            break;
+          #ifdef LASER_PULSE
+            case 72: laser_pulse = true; break;
+          #endif
+          #ifdef SYNC_BUS
+            case 73: sync_point = true; break;
+          #endif
 
           default: FAIL(STATUS_GCODE_UNSUPPORTED_COMMAND); // [Unsupported M command]
         }            
@@ -203,6 +334,14 @@ uint8_t gc_execute_line(char *line)
            words (I,J,K,L,P,R) have multiple connotations and/or depend on the issued commands. */
         switch(letter){
           case 'F': word_bit = WORD_F; gc_block.values.f = value; break;
+          #ifdef LASER_PULSE
+            case 'L': word_bit = WORD_L; gc_block.values.l = int_value; break;
+          #endif
+          #if defined(USE_LINE_NUMBERS) || defined(LDR_READ_QUEUE)
+            case 'N': word_bit = WORD_N; gc_block.values.n = trunc(value); break;
+          #endif
+          case 'P': word_bit = WORD_P; gc_block.values.p = value; break;
+          case 'S': word_bit = WORD_S; gc_block.values.s = value; break;
           case 'T': word_bit = WORD_T; gc_block.values.t = int_value; break; // gc.values.t = int_value;
           case 'X': word_bit = WORD_X; gc_block.values.xyz[X_AXIS] = value; axis_words |= (1<<X_AXIS); break;
           /*case 'Y': word_bit = WORD_Y; gc_block.values.xyz[Y_AXIS] = value; axis_words |= (1<<Y_AXIS); break;
@@ -212,9 +351,9 @@ uint8_t gc_execute_line(char *line)
         
         // NOTE: Variable 'word_bit' is always assigned, if the non-command letter is valid.
         if (bit_istrue(value_words,bit(word_bit))) { FAIL(STATUS_GCODE_WORD_REPEATED); } // [Word repeated]
-        // Check for invalid negative values for words F, N, P, T, and S.
+        // Check for invalid negative values for words F, L, N, P, T, and S.
         // NOTE: Negative value check is done here simply for code-efficiency.
-        if ( bit(word_bit) & (bit(WORD_F)|bit(WORD_N)|bit(WORD_P)|bit(WORD_T)|bit(WORD_S)) ) {
+        if ( bit(word_bit) & (bit(WORD_F)|bit(WORD_L)|bit(WORD_N)|bit(WORD_P)|bit(WORD_T)|bit(WORD_S)) ) {
           if (value < 0.0) { FAIL(STATUS_NEGATIVE_VALUE); } // [Word value cannot be negative]
         }
         value_words |= bit(word_bit); // Flag to indicate parameter assigned.
@@ -259,9 +398,15 @@ uint8_t gc_execute_line(char *line)
   }
   
   // Check for valid line number N value.
+  #ifdef LDR_READ_QUEUE
+    int32_t ldr_read_tag = -1; // Tags a queued M50 read with the line number. Without N, the read count.
+  #endif
   if (bit_istrue(value_words,bit(WORD_N))) {
     // Line number value cannot be less than zero (done) or greater than max line number.
     if (gc_block.values.n > MAX_LINE_NUMBER) { FAIL(STATUS_GCODE_INVALID_LINE_NUMBER); } // [Exceeds max line number]
+    #ifdef LDR_READ_QUEUE
+      ldr_read_tag = gc_block.values.n;
+    #endif
   }
   // bit_false(value_words,bit(WORD_N)); // NOTE: Single-meaning value word. Set at end of error-checking.
   
@@ -308,7 +453,13 @@ uint8_t gc_execute_line(char *line)
   // bit_false(value_words,bit(WORD_F)); // NOTE: Single-meaning value word. Set at end of error-checking.
   
   // [4. Set spindle speed ]: S is negative (done.)
-  if (bit_isfalse(value_words,bit(WORD_S))) { gc_block.values.s = gc_state.spindle_speed; }
+  #ifdef LASER_PWM
+    // S is the intensity of the laser switched on by M71. Greater than 255. Full intensity when missing.
+    if (bit_isfalse(value_words,bit(WORD_S))) { gc_block.values.s = 255; }
+    else if (gc_block.values.s > 255) { FAIL(STATUS_INVALID_STATEMENT); }
+  #else
+    if (bit_isfalse(value_words,bit(WORD_S))) { gc_block.values.s = gc_state.spindle_speed; }
+  #endif
   // bit_false(value_words,bit(WORD_S)); // NOTE: Single-meaning value word. Set at end of error-checking.
     
   // [5. Select tool ]: NOT SUPPORTED. Only tracks value. T is negative (done.) Not an integer. Greater than max tool value.
@@ -325,6 +476,53 @@ uint8_t gc_execute_line(char *line)
     bit_false(value_words,bit(WORD_P));
   }
   
+  // [10a. LDR streaming ]: Channel not sampled. Interval over the step counter range.
+  // NOTE: P is the sampling interval in degrees and is converted to steps here.
+  #ifdef LDR_STREAMING
+    if (gc_block.modal.ldr == LDR_STREAM) {
+      if (bit_istrue(value_words,bit(WORD_P))) {
+        if (gc_block.values.p > 0.0) {
+          if ((gc_block.values.t > 7) || !(LDR_CHANNEL_MASK & (1<<gc_block.values.t))) { FAIL(STATUS_INVALID_STATEMENT); }
+          gc_block.values.p = max(round(gc_block.values.p*settings.steps_per_deg[X_AXIS]),1.0);
+          if (gc_block.values.p > 0xFFFF) { FAIL(STATUS_INVALID_STATEMENT); }
+        }
+        bit_false(value_words,bit(WORD_P));
+      } else {
+        gc_block.values.p = 0.0; // No interval stops the stream.
+      }
+    }
+  #endif
+
+  // [10b. Laser strobe ]: P is the strobe window of the laser switched on by M71 in milliseconds.
+  // Continuous when missing. Window over the tick counter range.
+  #if defined(LASER_PWM) && defined(CAMERA_TRIGGER)
+    if (laser_command && (gc_block.modal.laser == LASER_ENABLE)) {
+      if (bit_istrue(value_words,bit(WORD_P))) {
+        gc_block.values.p = round(gc_block.values.p*(1000.0/LASER_PWM_TICK_US));
+        if (gc_block.values.p > 0xFFFF) { FAIL(STATUS_INVALID_STATEMENT); }
+        bit_false(value_words,bit(WORD_P));
+      } else {
+        gc_block.values.p = 0.0;
+      }
+    }
+  #endif
+
+  // [10c. Laser pulse ]: P is the pulse duration in milliseconds, and L the laser chained after it.
+  // M70/M71 in the same block. T or L not a laser. P missing, zero or over 65535.
+  #ifdef LASER_PULSE
+    if (laser_pulse) {
+      if (laser_command) { FAIL(STATUS_GCODE_MODAL_GROUP_VIOLATION); }
+      if ((gc_block.values.t < 1) || (gc_block.values.t > N_LASER)) { FAIL(STATUS_INVALID_STATEMENT); }
+      if (bit_istrue(value_words,bit(WORD_L))) {
+        if ((gc_block.values.l < 1) || (gc_block.values.l > N_LASER)) { FAIL(STATUS_INVALID_STATEMENT); }
+        bit_false(value_words,bit(WORD_L));
+      }
+      if (bit_isfalse(value_words,bit(WORD_P))) { FAIL(STATUS_GCODE_VALUE_WORD_MISSING); } // [P word missing]
+      if ((gc_block.values.p <= 0.0) || (gc_block.values.p > 65535.0)) { FAIL(STATUS_INVALID_STATEMENT); }
+      bit_false(value_words,bit(WORD_P));
+    }
+  #endif
+
   // [11. Set active plane ]: N/A
   switch (gc_block.modal.plane_select) {
     case PLANE_SELECT_XY:
@@ -661,6 +859,11 @@ uint8_t gc_execute_line(char *line)
   }
 
 
+  #ifdef SYNC_BUS
+    // [19a. Sync point ]: Armed ahead of the motion, so the motion of the same block is held too.
+    if (sync_point) { mc_sync(); }
+  #endif
+
   // [20. Motion modes ]:
   // NOTE: Commands G10,G28,G30,G92 lock out and prevent axis words from use in motion modes. 
   // Enter motion modes only if there are axis words or a motion mode command word in the block.
@@ -713,22 +916,39 @@ uint8_t gc_execute_line(char *line)
 
   // [22. Laser control ]:  
   gc_state.modal.laser = gc_block.modal.laser;
+  #ifdef LASER_PULSE
+    // M72 leaves the laser states alone. Without L, the next laser is 0-1, which is none.
+    if (laser_pulse) { mc_laser_pulse(gc_block.values.t-1, lround(gc_block.values.p*1000), gc_block.values.l-1); }
+    else
+  #endif
   laser_run(gc_block.values.t, gc_block.modal.laser);
+  #ifdef LASER_PWM
+    if (laser_command && (gc_block.modal.laser == LASER_ENABLE)) {
+      laser_set_intensity(gc_block.values.t-1, gc_block.values.s);
+      #ifdef CAMERA_TRIGGER
+        laser_set_strobe(gc_block.values.t-1, gc_block.values.p);
+      #endif
+    }
+  #endif
 
   // [23. Motor control ]:  
   gc_state.modal.motor = gc_block.modal.motor;
-  if (gc_block.modal.motor == MOTOR_ENABLE) {
-    st_disable_on_idle(false);
-    st_wake_up();
-  }
-  else {
-    st_disable_on_idle(true);
-    st_go_idle();
-  }
+  gc_run_motor(gc_block.modal.motor);
   // [23. LDR read ]:
   if (gc_block.modal.ldr == LDR_READ){
+    #ifdef LDR_READ_QUEUE
+      ldr_read_queue(gc_block.values.t, ldr_read_tag);
+    #else
       print_ldr(gc_block.values.t);
+    #endif
   }
+  #ifdef LDR_STREAMING
+    // [23a. LDR streaming ]: Start or stop at the current position of the buffered motions.
+    if (gc_block.modal.ldr == LDR_STREAM){
+        protocol_buffer_synchronize();
+        ldr_stream_start(gc_block.values.t, gc_block.values.p);
+    }
+  #endif
 
   // TODO: % to denote start of program. Sets auto cycle start?
   return(STATUS_OK);
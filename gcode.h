@@ -127,7 +127,8 @@
 #define MOTOR_DISABLE 0 // M18
 
 // Modal Group: LDR
-#define LDR_READ 1
+#define LDR_READ 1 // M50
+#define LDR_STREAM 2 // M51
 
 #define WORD_F  0
 #define WORD_I  1
@@ -160,7 +161,7 @@ typedef struct {
   uint8_t spindle;       // {M3,M4,M5}
   uint8_t laser;         // {M70,M71}
   uint8_t motor;         // {M17,M18}
-  uint8_t ldr;            // {M50}
+  uint8_t ldr;            // {M50,M51}
 } gc_modal_t;  
 
 typedef struct {
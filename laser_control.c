@@ -22,43 +22,167 @@
 #include "laser_control.h"
 #include "protocol.h"
 #include "gcode.h"
-
-// Used to count 1 second with timer2
-volatile uint8_t timer = 0;
+#include "planner.h"
+#include "clock.h"
+#include "timer.h"
 
 // Laser status array
 volatile uint8_t laser[4];
 
-// Laser timer array
-volatile uint8_t laser_timer[4];
+#ifdef LASER_MOTION_SYNC
+// Laser state requested by the parser. Bit n is laser n.
+volatile uint8_t laser_target = 0;
+
+// Lasers last switched by a realtime command. Queued blocks leave them alone until the next M70/M71.
+static volatile uint8_t laser_realtime_mask = 0;
+
+// Lasers switched off by the safety timeout. Queued blocks don't light them again until the next M71.
+static volatile uint8_t laser_timeout_mask = 0;
+#endif
+
+#ifdef LASER_PWM
+// The compare interrupt at TOP runs the software PWM, and every LASER_PWM_TIMER_TICKS of them
+// the 1kHz software timer tick.
+#define LASER_PWM_TIMER_TICKS 10 // 10kHz/10 = 1kHz
+
+static const uint8_t laser_pwm_bit[N_LASER] = { (1<<LASER1_BIT), (1<<LASER2_BIT), (1<<LASER3_BIT), (1<<LASER4_BIT) };
+
+static volatile uint8_t laser_pwm_output;     // Port bits of the lasers switched on
+static uint8_t laser_intensity[N_LASER];      // Intensity (0-255) of each laser
+static uint8_t laser_pwm_accumulator[N_LASER]; // Sigma-delta modulator state of each laser
+static uint8_t laser_pwm_tick;                // Divides the PWM rate down to the timer rate
+#ifdef CAMERA_TRIGGER
+static volatile uint16_t laser_strobe[N_LASER]; // Strobe window of each laser in ticks. Zero is continuous.
+static volatile uint16_t laser_strobe_elapsed; // Ticks since the last camera trigger
+#endif
+#endif
+
+#ifdef LASER_PULSE
+#define LASER_PULSE_NONE 0xFF
+
+static volatile uint8_t laser_pulse_id;       // Laser lit by the running pulse. LASER_PULSE_NONE when idle.
+static uint8_t laser_pulse_next;              // Laser chained after it, or LASER_PULSE_NONE
+static uint32_t laser_pulse_length;           // Pulse duration in Timer2 counts, or PWM periods with LASER_PWM
+static volatile uint32_t laser_pulse_periods; // Timer2 periods left until the pulse end
+#ifndef LASER_PWM
+static uint8_t laser_pulse_end;               // Timer2 count of the pulse end within its period
+#endif
+#endif
 
 void laser_init()
 {
   // Initialize lasers
   LASER_DDR |= LASER_MASK;
   LASER_PORT &= ~LASER_MASK;
+  uint8_t i;
+  for (i = 0; i < 4; i++) {
+    laser[i] = 0;
+  }
+#ifdef LASER_MOTION_SYNC
+  laser_target = 0;
+  laser_realtime_mask = 0;
+  laser_timeout_mask = 0;
+#endif
 
   // Initialize timer2
   cli();                              // disable interrupts
   TCNT2  = 0;                         // initialize counter value
-  OCR2A = 244-1;                      // compare match register 16MHz/256/256Hz
+#ifdef LASER_PWM
+  laser_pwm_output = 0;
+  laser_pwm_tick = 0;
+  for (i = 0; i < N_LASER; i++) {
+    laser_intensity[i] = 255;
+    laser_pwm_accumulator[i] = 0;
+#ifdef CAMERA_TRIGGER
+    laser_strobe[i] = 0;
+#endif
+  }
+#ifdef CAMERA_TRIGGER
+  laser_strobe_elapsed = 0xFFFF;
+#endif
+  OCR2A = LASER_PWM_TOP;              // 16MHz/8/200 = 10kHz
+  OCR2B = LASER_PWM_TOP;
+  TCCR2A = (1 << WGM21) | (1 << WGM20); // Fast PWM mode, TOP = OCR2A. OC2B connected when in use.
+  TCCR2B = (1 << WGM22) | (1 << CS21);  // 8 prescaler
+#else
+  OCR2A = LASER_TIMER_TOP;            // compare match register 16MHz/64/1kHz
   TCCR2A = (1 << WGM21);              // CTC mode
-  TCCR2B = (1 << CS22) | (1 << CS21); // 256 prescaler
+  TCCR2B = (1 << CS22);               // 64 prescaler
+#endif
+#ifdef LASER_PULSE
+  laser_pulse_id = LASER_PULSE_NONE;
+  laser_pulse_next = LASER_PULSE_NONE;
+  laser_pulse_periods = 0;
+  TIMSK2 &= ~(1 << OCIE2B);           // disable the pulse end interrupt
+#endif
   TIMSK2 |= (1 << OCIE2A);            // enable timer compare interrupt
   sei();                              // enable interrupts
 }
 
+// NOTE: With LASER_PWM, the outputs are driven by the Timer2 interrupt within one PWM period.
+// Otherwise the port is written as a read-modify-write, which the serial, stepper and Timer2
+// interrupts may interrupt with their own laser writes, so it's done with interrupts disabled.
 void laser_on(uint8_t laser_bit)
 {
-  LASER_PORT |= laser_bit;
+#ifdef LASER_PWM
+  bit_true_atomic(laser_pwm_output, laser_bit);
+#else
+  bit_true_atomic(LASER_PORT, laser_bit);
+#endif
 }
 
 void laser_off(uint8_t laser_bit)
 {
-  LASER_PORT &= ~laser_bit;
+#ifdef LASER_PWM
+  bit_false_atomic(laser_pwm_output, laser_bit);
+#else
+  bit_false_atomic(LASER_PORT, laser_bit);
+#endif
 }
 
-void laser_set(uint8_t id, uint8_t value)
+#ifdef LASER_PWM
+void laser_set_intensity(uint8_t id, uint8_t intensity)
+{
+  if (id >= N_LASER) { return; }
+  uint8_t sreg = SREG;
+  cli();
+  laser_intensity[id] = intensity;
+  if (id == LASER_PWM_ID) { OCR2B = ((uint16_t)intensity*(LASER_PWM_TOP+1)) >> 8; }
+  SREG = sreg;
+}
+
+#ifdef CAMERA_TRIGGER
+void laser_set_strobe(uint8_t id, uint16_t ticks)
+{
+  if (id >= N_LASER) { return; }
+  uint8_t sreg = SREG;
+  cli();
+  laser_strobe[id] = ticks;
+  SREG = sreg;
+}
+
+// Called by the stepper interrupt with each camera trigger pulse, before it re-enables interrupts.
+void laser_strobe_start()
+{
+  laser_strobe_elapsed = 0;
+}
+#endif
+#endif
+
+// Switches a laser off once its safety timeout expires. Called by the Timer2 interrupt.
+static void laser_timeout(uint8_t id)
+{
+  id -= TIMER_LASER;
+#ifdef LASER_MOTION_SYNC
+  laser_timeout_mask |= bit(id);
+#endif
+  laser_set(id, LASER_DISABLE);
+}
+
+// Switches the laser output and keeps the safety timeout state. The output, laser[] and the timeout
+// change together with interrupts disabled, since the serial, stepper and Timer2 interrupts switch
+// the lasers too.
+static void laser_output(uint8_t id, uint8_t value)
 {
   uint8_t bit = 0;
 
@@ -70,35 +194,216 @@ void laser_set(uint8_t id, uint8_t value)
   }
   
   if (bit > 0) {
+    uint8_t sreg = SREG;
+    cli();
     if (value == LASER_ENABLE) {
       laser_on(bit);
+      // The timeout runs from the moment the laser was switched on, not from the latest request.
+      if (!laser[id]) { timer_start(TIMER_LASER+id, LASER_TIMEOUT*1000UL, 0, laser_timeout); }
       laser[id] = 1;
     } else {
       laser_off(bit);
       laser[id] = 0;
-      laser_timer[id] = 0;
+      timer_stop(TIMER_LASER+id);
     }
+    SREG = sreg;
   }
 }
 
+void laser_set(uint8_t id, uint8_t value)
+{
+#ifdef LASER_MOTION_SYNC
+  if (id < N_LASER) {
+    if (value == LASER_ENABLE) { bit_true_atomic(laser_target, bit(id)); }
+    else { bit_false_atomic(laser_target, bit(id)); }
+  }
+#endif
+  laser_output(id, value);
+}
+
+void laser_realtime(uint8_t command)
+{
+  uint8_t id = command-CMD_LASER_ON;
+  uint8_t value = LASER_ENABLE;
+  if (command >= CMD_LASER_OFF) { id = command-CMD_LASER_OFF; value = LASER_DISABLE; }
+  if ((id >= N_LASER) || (sys.state == STATE_CHECK_MODE)) { return; }
+#ifdef LASER_MOTION_SYNC
+  laser_realtime_mask |= bit(id);
+#endif
+  laser_set(id, value);
+}
+
+#ifdef LASER_MOTION_SYNC
+void laser_apply(uint8_t state)
+{
+  uint8_t i;
+  // A realtime command or timeout between the checks and the switch would be undone.
+  uint8_t sreg = SREG;
+  cli();
+  state &= ~laser_timeout_mask;
+  for (i = 0; i < N_LASER; i++) {
+    if (bit_istrue(laser_realtime_mask, bit(i))) { continue; }
+    // Only switch the changed lasers, so the timeout of the others keeps running.
+    if (bit_istrue(state, bit(i)) != laser[i]) {
+      laser_output(i, bit_istrue(state, bit(i)) ? LASER_ENABLE : LASER_DISABLE);
+    }
+  }
+  SREG = sreg;
+}
+#endif
+
+#ifdef LASER_PULSE
+static void laser_pulse_start(uint8_t id, uint8_t count);
+
+// Ends the running pulse, and starts the chained one right away. Called with interrupts disabled.
+static void laser_pulse_stop()
+{
+  laser_output(laser_pulse_id, LASER_DISABLE);
+  uint8_t next = laser_pulse_next;
+  laser_pulse_next = LASER_PULSE_NONE;
+#ifdef LASER_PWM
+  if (next < N_LASER) { laser_pulse_start(next, 0); }
+#else
+  TIMSK2 &= ~(1 << OCIE2B);
+  // The chained pulse starts from the scheduled end, so a late end doesn't add to its duration.
+  if (next < N_LASER) { laser_pulse_start(next, laser_pulse_end); }
+#endif
+  else { laser_pulse_id = LASER_PULSE_NONE; }
+}
+
+#ifdef LASER_PWM
+// Lights the laser and counts the PWM periods of the pulse. The outputs follow at the next period,
+// unless count is zero when called by the Timer2 interrupt before it sets them.
+static void laser_pulse_start(uint8_t id, uint8_t count)
+{
+  laser_output(id, LASER_ENABLE);
+  laser_pulse_id = id;
+  laser_pulse_periods = laser_pulse_length+count;
+}
+#else
+// Arms the compare interrupt at the pulse end in the running Timer2 period.
+static void laser_pulse_arm()
+{
+  OCR2B = laser_pulse_end;
+  TIFR2 = (1 << OCF2B);               // clear any earlier compare match
+  TIMSK2 |= (1 << OCIE2B);
+  // The end may have passed before the match flag was cleared. End the pulse now then.
+  if ((TCNT2 >= laser_pulse_end) && !(TIFR2 & (1 << OCF2B))) { laser_pulse_stop(); }
+}
+
+// Lights the laser and schedules the pulse end, counted from the Timer2 count the laser was lit at.
+static void laser_pulse_start(uint8_t id, uint8_t count)
+{
+  laser_output(id, LASER_ENABLE);
+  laser_pulse_id = id;
+  uint32_t end = count+laser_pulse_length;
+  laser_pulse_periods = end/(LASER_TIMER_TOP+1);
+  laser_pulse_end = end%(LASER_TIMER_TOP+1);
+  if (!laser_pulse_periods) { laser_pulse_arm(); }
+}
+#endif
+
+void laser_pulse(uint8_t id, uint32_t usec, uint8_t next)
+{
+  if (id >= N_LASER) { return; }
+  uint8_t sreg = SREG;
+  cli();
+  if (laser_pulse_id != LASER_PULSE_NONE) { laser_pulse_next = LASER_PULSE_NONE; laser_pulse_stop(); }
+  laser_pulse_next = next;
+#ifdef LASER_PWM
+  laser_pulse_length = max((usec+LASER_PWM_TICK_US/2)/LASER_PWM_TICK_US, 1);
+  laser_pulse_start(id, 1);
+#else
+  laser_pulse_length = max((usec*TICKS_PER_MICROSECOND+LASER_TIMER_PRESCALER/2)/LASER_TIMER_PRESCALER, 1);
+  uint8_t count = TCNT2;
+  laser_pulse_start(id, count);
+  // A period may have ended since the interrupt was blocked. Its pending interrupt doesn't count.
+  if (laser_pulse_periods && (TIFR2 & (1 << OCF2A)) && (count < LASER_TIMER_TOP)) { laser_pulse_periods++; }
+#endif
+  SREG = sreg;
+}
+
+uint8_t laser_pulse_active() { return(laser_pulse_id != LASER_PULSE_NONE); }
+#endif
+
 void laser_run(uint8_t id, uint8_t value)
 {
   if (sys.state == STATE_CHECK_MODE) { return; }
 
   protocol_auto_cycle_start();
+#ifdef LASER_MOTION_SYNC
+  id--;
+  if (id >= N_LASER) { return; }
+  if (value == LASER_ENABLE) {
+    bit_true_atomic(laser_target, bit(id));
+    bit_false_atomic(laser_timeout_mask, bit(id)); // A new M71 lights the timed-out laser again.
+  }
+  else { bit_false_atomic(laser_target, bit(id)); }
+  bit_false_atomic(laser_realtime_mask, bit(id)); // The queued state takes over the laser again.
+  // With no motion queued or running, apply it now. Otherwise the stepper interrupt applies it
+  // when the next queued block starts, or when the segment buffer runs empty.
+  if (bit_isfalse(TIMSK1, bit(OCIE1A)) && !plan_get_current_block()) { laser_apply(laser_target); }
+#else
   protocol_buffer_synchronize();
 
   laser_set(id-1, value);
+#endif
 }
 
 ISR(TIMER2_COMPA_vect)
 {
-  if (!++timer) { // 1 second reached!
-    uint8_t i;
-    for (i = 0; i < 4; i++) {
-      if (laser[i]) laser_timer[i]++;
-      if (laser_timer[i] == 255) // Laser i disabled after 255 seconds max
-        laser_set(i, LASER_DISABLE);
-    }
+  clock_ticks++;
+#ifdef LASER_PULSE
+  // The pulse ends in the period it counted down to: with LASER_PWM at its start, otherwise at the
+  // compare match set up here.
+  if (laser_pulse_periods && !--laser_pulse_periods) {
+#ifdef LASER_PWM
+    laser_pulse_stop();
+#else
+    laser_pulse_arm();
+#endif
   }
-}
\ No newline at end of file
+#endif
+#ifdef LASER_PWM
+  uint8_t output = laser_pwm_output;
+  uint8_t i;
+#ifdef CAMERA_TRIGGER
+  uint16_t elapsed = laser_strobe_elapsed;
+  if (elapsed < 0xFFFF) { laser_strobe_elapsed = elapsed+1; }
+#endif
+  for (i = 0; i < N_LASER; i++) {
+    if (!(output & laser_pwm_bit[i])) { continue; }
+#ifdef CAMERA_TRIGGER
+    // Strobed lasers are only lit within their window after a camera trigger.
+    if (laser_strobe[i] && (elapsed >= laser_strobe[i])) { output &= ~laser_pwm_bit[i]; continue; }
+#endif
+    if (laser_intensity[i] == 255) { continue; }
+    if (!laser_intensity[i]) { output &= ~laser_pwm_bit[i]; continue; }
+    if (i == LASER_PWM_ID) { continue; } // Hardware PWM
+    // First-order sigma-delta modulation. Lit on the ticks the accumulator overflows.
+    uint8_t accumulator = laser_pwm_accumulator[i] + laser_intensity[i];
+    if (accumulator >= laser_pwm_accumulator[i]) { output &= ~laser_pwm_bit[i]; }
+    laser_pwm_accumulator[i] = accumulator;
+  }
+  // Hand the dimmed hardware PWM laser over to the OC2B output. Otherwise drive it from the port.
+  if ((output & laser_pwm_bit[LASER_PWM_ID]) && (laser_intensity[LASER_PWM_ID] != 255)) {
+    TCCR2A |= (1 << COM2B1);
+    output &= ~laser_pwm_bit[LASER_PWM_ID];
+  } else {
+    TCCR2A &= ~(1 << COM2B1);
+  }
+  LASER_PORT = (LASER_PORT & ~LASER_MASK) | output;
+
+  if (++laser_pwm_tick < LASER_PWM_TIMER_TICKS) { return; }
+  laser_pwm_tick = 0;
+#endif
+  timer_tick(); // 1 millisecond reached. Expires the laser timeouts, among the other timers.
+}
+
+#if defined(LASER_PULSE) && !defined(LASER_PWM)
+// Compare match at the pulse end.
+ISR(TIMER2_COMPB_vect)
+{
+  laser_pulse_stop();
+}
+#endif
@@ -25,6 +25,56 @@
 void laser_init();
 void laser_off(uint8_t laser_bit);
 void laser_on(uint8_t laser_bit);
+void laser_set(uint8_t id, uint8_t value);
 void laser_run(uint8_t mode, uint8_t value);
 
+// Switches a laser at once for a CMD_LASER_ON/CMD_LASER_OFF realtime command byte. Ignored in
+// check mode. With LASER_MOTION_SYNC, the laser keeps this state over the queued blocks until the
+// next M70/M71. Called by the serial receive interrupt only.
+void laser_realtime(uint8_t command);
+
+#ifdef LASER_PWM
+// Timer2 runs in fast PWM mode with TOP = OCR2A: 16MHz/8/(LASER_PWM_TOP+1) = 10kHz.
+#define LASER_PWM_TOP 199
+#define LASER_PWM_TICK_US (((LASER_PWM_TOP+1)*8)/TICKS_PER_MICROSECOND) // PWM period
+#define LASER_TIMER_TOP LASER_PWM_TOP
+#define LASER_TIMER_PRESCALER 8
+#else
+// Timer2 runs in CTC mode for the 1kHz software timer tick: 16MHz/64/(LASER_TIMER_TOP+1).
+#define LASER_TIMER_TOP (250-1)
+#define LASER_TIMER_PRESCALER 64
+#endif
+
+#ifdef LASER_PWM
+
+// Sets the intensity (0-255) of the laser. 255 is continuously on.
+void laser_set_intensity(uint8_t id, uint8_t intensity);
+
+#ifdef CAMERA_TRIGGER
+// Sets the strobe window of the laser in PWM ticks (LASER_PWM_TICK_US). Zero is continuous.
+void laser_set_strobe(uint8_t id, uint16_t ticks);
+
+// Opens the strobe window. Called by the stepper interrupt with each camera trigger pulse.
+void laser_strobe_start();
+#endif
+#endif
+
+#ifdef LASER_PULSE
+// Lights the laser (0-3) for usec microseconds, timed by Timer2, and then the next laser for as long
+// right after it, unless next is not a laser. Cuts short a running pulse. With LASER_PWM, the
+// duration is rounded to whole PWM periods.
+void laser_pulse(uint8_t id, uint32_t usec, uint8_t next);
+
+// Returns true while a pulse or its chained pulse is lit.
+uint8_t laser_pulse_active();
+#endif
+
+#ifdef LASER_MOTION_SYNC
+// Laser state requested by the parser (bit n is laser n). Queued with each planner block.
+extern volatile uint8_t laser_target;
+
+// Switches the lasers to the state. Called by the stepper interrupt as a queued block starts.
+void laser_apply(uint8_t state);
+#endif
+
 #endif
\ No newline at end of file
@@ -18,28 +18,266 @@
   along with Horus.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include "system.h"
 #include "ldr.h"
+#include "print.h"
+#include "serial.h"
+#include "report.h"
+#include "planner.h"
+#include "protocol.h"
+
+#if LDR_CHANNEL_MASK == 0
+  #error "LDR_CHANNEL_MASK must enable at least one ADC channel."
+#endif
+#if (LDR_OVERSAMPLE > 6) || (LDR_EXTRA_BITS > (LDR_OVERSAMPLE/2))
+  #error "LDR_OVERSAMPLE or LDR_EXTRA_BITS out of range."
+#endif
+
+// Filtered readings ring, one row per sampled channel in channel order. Written by the ADC interrupt.
+static volatile uint16_t ldr_filter[LDR_N_CHANNEL][LDR_FILTER_SIZE];
+static uint8_t ldr_filter_head;   // Next ring entry to be written
+static uint8_t ldr_filter_primed; // False until every channel has its first reading
+
+// Oversampling state of the ADC interrupt.
+static uint8_t ldr_channel;       // ADC channel being sampled
+static uint8_t ldr_slot;          // Ring row of the channel being sampled
+static uint8_t ldr_sample_count;  // Samples accumulated for the current reading
+static uint16_t ldr_sample_sum;   // Sum of the samples of the current reading
+
+#ifdef LDR_STREAMING
+  #define LDR_STREAM_RECORD_MAX 23  // Longest record: '[L:-2147483648,65535]\r\n'
+  #if LDR_STREAM_RECORD_MAX > (TX_BUFFER_SIZE-1)
+    #error "TX_BUFFER_SIZE too small for LDR streaming records."
+  #endif
+
+  typedef struct {
+    int32_t position;  // Machine position in steps when the record was latched
+    uint16_t value;    // Latest reading of the streamed channel at that position
+  } ldr_record_t;
+
+  // Latched records ring. Written by the stepper interrupt, sent by the main program.
+  static ldr_record_t ldr_stream_buffer[LDR_STREAM_BUFFER_SIZE];
+  static volatile uint8_t ldr_stream_head;
+  static volatile uint8_t ldr_stream_tail;
+
+  static uint8_t ldr_stream_slot;            // Ring row of the streamed channel
+  static volatile uint16_t ldr_stream_value; // Latest reading of the streamed channel
+  static uint16_t ldr_stream_interval;       // Steps between records. Zero when not streaming.
+  static uint16_t ldr_stream_count;          // Steps since the last record
+#endif
+
+#ifdef LDR_READ_QUEUE
+  #define LDR_READ_RECORD_MAX 23  // Longest record: '[R:-2147483648,65535]\r\n'
+  #if LDR_READ_RECORD_MAX > (TX_BUFFER_SIZE-1)
+    #error "TX_BUFFER_SIZE too small for LDR read records."
+  #endif
+
+  #define LDR_SLOT_NONE 0xFF
+
+  typedef struct {
+    int32_t tag;       // N line number or read count
+    uint8_t slot;      // Ring row of the channel, or LDR_SLOT_NONE if it isn't sampled
+    uint16_t value;    // Filtered value, latched when the read falls due
+  } ldr_request_t;
+
+  // Queued reads ring. From tail to due are latched and wait to be sent, from due to head wait for
+  // the queued motions.
+  static ldr_request_t ldr_read_buffer[LDR_READ_QUEUE_SIZE];
+  volatile uint8_t ldr_read_head;
+  static volatile uint8_t ldr_read_due;
+  static uint8_t ldr_read_tail;
+  static uint32_t ldr_read_count; // Reads queued since reset
+#endif
+
 
 void ldr_init(void){
+ ldr_filter_head = 0;
+ ldr_filter_primed = false;
+ ldr_slot = 0;
+ ldr_sample_count = 0;
+ ldr_sample_sum = 0;
+ ldr_channel = 0;
+ while (!(LDR_CHANNEL_MASK & (1<<ldr_channel))) { ldr_channel++; } // First sampled channel
+
+ DIDR0 |= (LDR_CHANNEL_MASK & 0x3F);  //Disable the digital input buffers of the sampled pins
+ ADMUX = (1<<REFS0) | ldr_channel;    //Voltage reference from Avcc (5v) and first channel
  ADCSRA |= ((1<<ADPS2)|(1<<ADPS1)|(1<<ADPS0));    //16Mhz/128 = 125Khz the ADC reference clock
- ADMUX |= (1<<REFS0);                //Voltage reference from Avcc (5v)
- ADCSRA |= (1<<ADEN);                //Turn on ADC
- ADCSRA |= (1<<ADSC);                //Do an initial conversion because this one is the slowest and to ensure that everything is up and running
+ ADCSRA |= (1<<ADEN) | (1<<ADIE);     //Turn on ADC and its conversion complete interrupt
+ ADCSRA |= (1<<ADSC);                 //Start the first conversion. The ADC interrupt keeps it running.
 }
- 
-uint16_t ldr_read(uint8_t tool){
- ADMUX &= 0xF0;                    //Clear the older channel that was read
- ADMUX |= tool;                //Defines the new ADC channel to be read
- ADCSRA |= (1<<ADSC);                //Starts a new conversion
- while(ADCSRA & (1<<ADSC));            //Wait until the conversion is done
- return ADCW;                    //Returns the ADC value of the chosen channel
+
+
+// ADC conversion complete interrupt. Accumulates the samples of one channel into a reading, stores
+// it in the channel filter ring and moves on to the next channel. Every conversion is started from
+// here in single conversion mode, so the channel is always switched between conversions.
+// NOTE: The first sample after a channel switch is discarded, giving high impedance LDR dividers
+// a full conversion to settle on the sample and hold capacitor.
+ISR(ADC_vect)
+{
+  uint16_t sample = ADCW;
+  #ifdef DIAGNOSTIC_COUNTERS
+    diag.tick++; // Conversions run back to back, so they double as the diagnostic timebase.
+  #endif
+  if (ldr_sample_count++) { ldr_sample_sum += sample; }
+  if (ldr_sample_count > (1<<LDR_OVERSAMPLE)) {
+    #if LDR_OVERSAMPLE > LDR_EXTRA_BITS
+      // Decimate with rounding.
+      sample = (ldr_sample_sum + (1<<(LDR_OVERSAMPLE-LDR_EXTRA_BITS-1))) >> (LDR_OVERSAMPLE-LDR_EXTRA_BITS);
+    #else
+      sample = ldr_sample_sum;
+    #endif
+    #ifdef LDR_STREAMING
+      if (ldr_slot == ldr_stream_slot) { ldr_stream_value = sample; }
+    #endif
+    if (ldr_filter_primed) { ldr_filter[ldr_slot][ldr_filter_head] = sample; }
+    else {
+      uint8_t idx;
+      for (idx=0; idx<LDR_FILTER_SIZE; idx++) { ldr_filter[ldr_slot][idx] = sample; }
+    }
+    ldr_sample_count = 0;
+    ldr_sample_sum = 0;
+
+    // Advance to the next sampled channel. The ring advances after the last one.
+    do {
+      ldr_channel = (ldr_channel+1) & 0x07;
+    } while (!(LDR_CHANNEL_MASK & (1<<ldr_channel)));
+    if (++ldr_slot == LDR_N_CHANNEL) {
+      ldr_slot = 0;
+      ldr_filter_primed = true;
+      if (++ldr_filter_head == LDR_FILTER_SIZE) { ldr_filter_head = 0; }
+    }
+    ADMUX = (ADMUX & 0xF0) | ldr_channel;
+  }
+  ADCSRA |= (1<<ADSC); // Start next conversion
+}
+
+
+// Returns the ring row of a sampled channel.
+static uint8_t ldr_get_slot(uint8_t channel){
+ uint8_t slot = 0;
+ uint8_t idx;
+ for (idx=0; idx<channel; idx++) { if (LDR_CHANNEL_MASK & (1<<idx)) { slot++; } }
+ return slot;
+}
+
+
+// Returns the filtered value of a ring row.
+static uint16_t ldr_filter_value(uint8_t slot){
+ uint8_t idx;
+
+ uint32_t sum = 0;
+ uint8_t sreg = SREG;
+ cli();                               //Keep the ring consistent while adding it up
+ for (idx=0; idx<LDR_FILTER_SIZE; idx++) { sum += ldr_filter[slot][idx]; }
+ SREG = sreg;
+ return (sum+LDR_FILTER_SIZE/2)/LDR_FILTER_SIZE;
+}
+
+
+uint16_t ldr_read(uint8_t channel){
+ if ((channel > 7) || !(LDR_CHANNEL_MASK & (1<<channel))) { return 0; }
+ return ldr_filter_value(ldr_get_slot(channel));  //Returns the filtered value of the chosen channel
 }
 
 void print_ldr(uint8_t tool){
- if (tool >=0){
- char buffer[5];
- itoa(ldr_read(tool), buffer, 10);
- printString(buffer);
- printString("\r\n");
+ print_uint32_base10(ldr_read(tool));
+ printPgmString(PSTR("\r\n"));
+}
+
+
+#ifdef LDR_STREAMING
+void ldr_stream_start(uint8_t channel, uint16_t interval){
+ uint16_t value = ldr_read(channel);  //Seed with the filtered value until the next reading
+ uint8_t sreg = SREG;
+ cli();
+ ldr_stream_slot = ldr_get_slot(channel);
+ ldr_stream_value = value;
+ ldr_stream_interval = interval;
+ ldr_stream_count = 0;
+ SREG = sreg;
+}
+
+
+// NOTE: The stepper interrupt re-enables interrupts, so the ADC interrupt may update the latest
+// reading while it is copied.
+void ldr_stream_step(){
+ if (ldr_stream_interval) {
+   if (++ldr_stream_count == ldr_stream_interval) {
+     ldr_stream_count = 0;
+     uint8_t next_head = ldr_stream_head+1;
+     if (next_head == LDR_STREAM_BUFFER_SIZE) { next_head = 0; }
+     if (next_head != ldr_stream_tail) {  //Drop the record if the buffer is full
+       ldr_stream_buffer[ldr_stream_head].position = sys.position[X_AXIS];
+       uint8_t sreg = SREG;
+       cli();
+       ldr_stream_buffer[ldr_stream_head].value = ldr_stream_value;
+       SREG = sreg;
+       ldr_stream_head = next_head;
+     }
+   }
+ }
+}
+
+
+void ldr_stream_report(){
+ while (ldr_stream_tail != ldr_stream_head) {
+   if (serial_get_tx_buffer_count() > (TX_BUFFER_SIZE-1-LDR_STREAM_RECORD_MAX)) { return; }
+   report_ldr_record(ldr_stream_buffer[ldr_stream_tail].position, ldr_stream_buffer[ldr_stream_tail].value);
+   uint8_t next_tail = ldr_stream_tail+1;
+   if (next_tail == LDR_STREAM_BUFFER_SIZE) { next_tail = 0; }
+   ldr_stream_tail = next_tail;
+ }
+}
+#endif
+
+
+#ifdef LDR_READ_QUEUE
+void ldr_read_reset(){
+ ldr_read_head = 0;
+ ldr_read_due = 0;
+ ldr_read_tail = 0;
+ ldr_read_count = 0;
+}
+
+
+void ldr_read_queue(uint8_t channel, int32_t tag){
+ uint8_t next_head = ldr_read_head+1;
+ if (next_head == LDR_READ_QUEUE_SIZE) { next_head = 0; }
+ while (next_head == ldr_read_tail) {  //Wait for the queued motions to free a slot
+   protocol_auto_cycle_start();  //Start them, as mc_line() does with a full planner buffer
+   protocol_execute_runtime();
+   if (sys.abort) { return; }
  }
-}
\ No newline at end of file
+ ldr_read_count++;
+ ldr_read_buffer[ldr_read_head].tag = (tag < 0) ? (int32_t)ldr_read_count : tag;
+ ldr_read_buffer[ldr_read_head].slot = (LDR_CHANNEL_MASK & (1<<channel)) ? ldr_get_slot(channel) : LDR_SLOT_NONE;
+ ldr_read_head = next_head;
+ // With no motion queued or running, the read is due now. Otherwise the stepper interrupt makes
+ // it due when the next queued block starts, or when the segment buffer runs empty.
+ if (bit_isfalse(TIMSK1, bit(OCIE1A)) && !plan_get_current_block()) { ldr_read_latch(next_head); }
+}
+
+
+// NOTE: Called by the stepper interrupt, which re-enables interrupts. ldr_filter_value() holds
+// off the ADC interrupt while it adds up the ring row.
+void ldr_read_latch(uint8_t mark){
+ uint8_t idx = ldr_read_due;
+ while (idx != mark) {
+   uint8_t slot = ldr_read_buffer[idx].slot;
+   ldr_read_buffer[idx].value = (slot == LDR_SLOT_NONE) ? 0 : ldr_filter_value(slot);
+   if (++idx == LDR_READ_QUEUE_SIZE) { idx = 0; }
+ }
+ ldr_read_due = mark;
+}
+
+
+void ldr_read_report(){
+ while (ldr_read_tail != ldr_read_due) {
+   if (serial_get_tx_buffer_count() > (TX_BUFFER_SIZE-1-LDR_READ_RECORD_MAX)) { return; }
+   report_ldr_read(ldr_read_buffer[ldr_read_tail].tag, ldr_read_buffer[ldr_read_tail].value);
+   uint8_t next_tail = ldr_read_tail+1;
+   if (next_tail == LDR_READ_QUEUE_SIZE) { next_tail = 0; }
+   ldr_read_tail = next_tail;
+ }
+}
+#endif
@@ -18,17 +18,54 @@
   along with Horus.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-#ifndef laser_control_h
-#define laser_control_h 
+#ifndef ldr_h
+#define ldr_h
 
-#include <avr/io.h>
-#include <stdlib.h>
-#define F_CPU 16000000UL
-#include <util/delay.h>
-#define BAUDRATE 9600
-#define BAUD_PRESCALLER (((F_CPU / (BAUDRATE * 16UL))) - 1)
+// Number of sampled channels in LDR_CHANNEL_MASK.
+#define LDR_N_CHANNEL (((LDR_CHANNEL_MASK>>0)&1)+((LDR_CHANNEL_MASK>>1)&1)+((LDR_CHANNEL_MASK>>2)&1)+ \
+                       ((LDR_CHANNEL_MASK>>3)&1)+((LDR_CHANNEL_MASK>>4)&1)+((LDR_CHANNEL_MASK>>5)&1)+ \
+                       ((LDR_CHANNEL_MASK>>6)&1)+((LDR_CHANNEL_MASK>>7)&1))
 
+// Setup the ADC and start the background sampling of the LDR channels.
 void ldr_init(void);
+
+// Returns the latest filtered value of the channel. Zero if the channel is not sampled.
 uint16_t ldr_read(uint8_t channel);
 
-#endif
\ No newline at end of file
+// Prints the latest filtered value of the channel.
+void print_ldr(uint8_t tool);
+
+#ifdef LDR_STREAMING
+  // Starts streaming the channel every interval steps. Zero interval stops the stream.
+  void ldr_stream_start(uint8_t channel, uint16_t interval);
+
+  // Counts a step of the streamed axis and latches a record when the interval is reached.
+  // Called by the stepper interrupt only.
+  void ldr_stream_step();
+
+  // Sends the latched records to the host while the serial TX buffer has room for them.
+  void ldr_stream_report();
+#endif
+
+#ifdef LDR_READ_QUEUE
+  // Read queue ring head. Each planner block carries the head index from when it was queued,
+  // and the stepper interrupt makes the reads queued before it due as the block starts.
+  extern volatile uint8_t ldr_read_head;
+
+  // Empties the read queue and restarts the read count.
+  void ldr_read_reset();
+
+  // Queues a read of the channel, due once the motions queued before it complete. Without a tag,
+  // a negative one, the read is tagged with the read count. Waits while the queue is full.
+  void ldr_read_queue(uint8_t channel, int32_t tag);
+
+  // Latches the filtered values of the reads queued before the mark head index and makes them due.
+  // Called by the stepper interrupt as a block starts or the motions end, so each value is taken
+  // at its queue position.
+  void ldr_read_latch(uint8_t mark);
+
+  // Sends the latched values of the due reads to the host while the serial TX buffer has room for them.
+  void ldr_read_report();
+#endif
+
+#endif
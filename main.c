@@ -35,17 +35,27 @@
 #include "probe.h"
 #include "report.h"
 #include "ldr.h"
+#include "laser_control.h"
+#include "timer.h"
+#include "sync.h"
 
 
 // Declare system global variable structure
 system_t sys; 
 
+#ifdef DIAGNOSTIC_COUNTERS
+  // Declare interrupt and buffer health counters. Zeroed on power-up and kept through resets.
+  diag_t diag;
+#endif
+
 
 int main(void)
 {
   // Initialize system upon power-up.
   serial_init();   // Setup serial baud rate and interrupts
   settings_init(); // Load grbl settings from EEPROM
+  // Switch to the stored baud rate. Interrupts are still off, so nothing was sent at the default.
+  if (settings.baud_rate != BAUD_RATE) { serial_set_baud_rate(settings.baud_rate); }
   stepper_init();  // Configure stepper pins and interrupt timers
   system_init();   // Configure pinout pins and pin-change interrupt
   ldr_init();        //Setup the ADC
@@ -75,8 +85,18 @@ int main(void)
     // Reset Grbl primary systems.
     serial_reset_read_buffer(); // Clear serial read buffer
     gc_init(); // Set g-code parser to default state
+    timer_init(); // Stop all software timers
     laser_init();
+    #ifdef LDR_STREAMING
+      ldr_stream_start(0,0); // Stop any LDR stream
+    #endif
+    #ifdef LDR_READ_QUEUE
+      ldr_read_reset(); // Drop any queued M50 reads
+    #endif
     probe_init();
+    #ifdef SYNC_BUS
+      sync_init(); // Drop any armed sync point
+    #endif
     plan_reset(); // Clear block buffer and planner variables
     st_reset(); // Clear stepper subsystem variables.
 
@@ -87,6 +107,8 @@ int main(void)
     // Reset system variables.
     sys.abort = false;
     sys.execute = 0;
+    sys.jog_rate = 0.0;
+    sys.f_override = 100;
     if (bit_istrue(settings.flags,BITFLAG_AUTO_START)) { sys.auto_start = true; }
     else { sys.auto_start = false; }
           
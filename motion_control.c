@@ -34,6 +34,9 @@
 #include "motion_control.h"
 #include "probe.h"
 #include "report.h"
+#include "laser_control.h"
+#include "timer.h"
+#include "sync.h"
 
 
 // Execute linear motion in absolute millimeter coordinates. Feed rate given in millimeters/second
@@ -220,54 +223,147 @@ void mc_dwell(float seconds)
 {
    if (sys.state == STATE_CHECK_MODE) { return; }
    
-   uint16_t i = floor(1000/DWELL_TIME_STEP*seconds);
+   uint32_t ms = lround(1000*seconds);
    protocol_buffer_synchronize();
-   delay_ms(floor(1000*seconds-i*DWELL_TIME_STEP)); // Delay millisecond remainder.
-   while (i-- > 0) {
-     // NOTE: Check and execute runtime commands during dwell every <= DWELL_TIME_STEP milliseconds.
+   if (!ms) { return; }
+   // NOTE: Runtime commands keep being executed while the dwell timer runs.
+   timer_start(TIMER_DWELL, ms, 0, NULL);
+   while (!timer_expired(TIMER_DWELL)) {
      protocol_execute_runtime();
      if (sys.abort) { return; }
-     _delay_ms(DWELL_TIME_STEP); // Delay DWELL_TIME_STEP increment
    }
 }
 
 
-/*// Perform homing cycle to locate and set machine zero. Only '$H' executes this command.
+// Moves towards target for the homing cycle, with the index sensor watched if watch is set. Returns
+// true when the sensor triggered, with its position in sys.probe_position, or false when the motion
+// completed first. Either way the rest of the motion is cleared and the planner is synced to where
+// the table stopped.
+static uint8_t mc_homing_move(float *target, float rate, uint8_t watch)
+{
+  #ifdef USE_LINE_NUMBERS
+    mc_line(target, rate, false, HOMING_CYCLE_LINE_NUMBER);
+  #else
+    mc_line(target, rate, false);
+  #endif
+  if (watch) { probe_activate(); }
+
+  bit_true_atomic(sys.execute, EXEC_CYCLE_START);
+  do {
+    protocol_execute_runtime(); 
+    if (sys.abort) { return(false); } // Check for system abort
+  } while ((sys.state != STATE_IDLE) && (sys.state != STATE_QUEUED));
+
+  #ifdef PROBE_PIN_INTERRUPT
+    if (sys.probe_state == PROBE_LATCH) { probe_latch_position(); }
+  #endif
+  uint8_t triggered = (watch && sys.probe_state == PROBE_OFF);
+  sys.probe_state = PROBE_OFF;
+
+  st_reset(); // Reset step segment buffer.
+  plan_reset(); // Reset planner buffer. Ensure the rest of the motion is cleared.
+  plan_sync_position(); // Sync planner position to current machine position.
+  sys.state = STATE_IDLE;
+  delay_ms(settings.homing_debounce_delay); // Let the table and the sensor settle.
+  return(triggered);
+}
+
+
+#ifdef LASER_PULSE
+// Fire a laser pulse. The pulse is already timed by Timer2, the runtime commands keep being
+// executed while it is lit.
+void mc_laser_pulse(uint8_t id, uint32_t usec, uint8_t next)
+{
+  if (sys.state == STATE_CHECK_MODE) { return; }
+
+  protocol_buffer_synchronize(); // The exposure starts once the table has stopped.
+  if (sys.abort) { return; } // Return if system reset has been issued.
+  laser_pulse(id, usec, next);
+  while (laser_pulse_active()) {
+    protocol_execute_runtime();
+    if (sys.abort) { return; }
+  }
+}
+#endif
+
+
+#ifdef SYNC_BUS
+// Arm the sync point for M73. The sync output tells the other units that this one is done.
+void mc_sync()
+{
+  if (sys.state == STATE_CHECK_MODE) { return; }
+
+  protocol_buffer_synchronize();
+  if (sys.abort) { return; } // Return if system reset has been issued.
+  sync_arm();
+}
+#endif
+
+
+// Perform homing cycle to locate and set machine zero. Only '$H' executes this command. The index
+// sensor on the probe pin is searched at the seek rate in the homing direction, and its edge is then
+// located again at the feed rate from the pull-off before it. The edge becomes the machine origin
+// and the table returns to it.
 // NOTE: There should be no motions in the buffer and Grbl must be in an idle state before
 // executing the homing cycle. This prevents incorrect buffered plans after homing.
 void mc_homing_cycle()
 {
-  sys.state = STATE_HOMING; // Set system state variable
-  limits_disable(); // Disable hard limits pin change register for cycle duration
-    
-  // -------------------------------------------------------------------------------------
-  // Perform homing routine. NOTE: Special motion case. Only system reset works.
-  
-  // Search to engage all axes limit switches at faster homing seek rate.
-  limits_go_home(HOMING_CYCLE_0);  // Homing cycle 0
-  #ifdef HOMING_CYCLE_1
-    limits_go_home(HOMING_CYCLE_1);  // Homing cycle 1
-  #endif
-  #ifdef HOMING_CYCLE_2
-    limits_go_home(HOMING_CYCLE_2);  // Homing cycle 2
-  #endif
-    
-  protocol_execute_runtime(); // Check for reset and set system abort.
-  if (sys.abort) { return; } // Did not complete. Alarm state set by mc_alarm.
+  sys.state = STATE_IDLE; // Clear the alarm lock, if set, to run the cycle motions.
+  uint8_t auto_start_state = sys.auto_start; // Store run state
 
-  // Homing cycle complete! Setup system for normal operation.
-  // -------------------------------------------------------------------------------------
+  float dir = bit_istrue(settings.homing_dir_mask,bit(X_AXIS)) ? -1.0 : 1.0;
+  float target[N_AXIS];
+  uint8_t idx;
+  for (idx=0; idx<N_AXIS; idx++) { target[idx] = sys.position[idx]/settings.steps_per_deg[idx]; }
 
-  // Gcode parser position was circumvented by the limits_go_home() routine, so sync position now.
-  gc_sync_position();
-  
-  // Set idle state after homing completes and before returning to main program.  
-  sys.state = STATE_IDLE;
-  st_go_idle(); // Set idle state after homing completes
+  // Only the trigger edge locates the index. Back off first if the table rests on the sensor.
+  if (probe_get_state()) {
+    target[X_AXIS] -= dir*settings.homing_pulloff;
+    mc_homing_move(target, settings.homing_seek_rate, false);
+    if (sys.abort) { return; } // Return if system reset has been issued.
+  }
 
-  // If hard limits feature enabled, re-enable hard limits pin change register after homing cycle.
-  limits_init();
-}*/
+  // Search the index at the seek rate, then re-approach its edge at the feed rate.
+  uint8_t found = false;
+  if (!probe_get_state()) {
+    target[X_AXIS] += dir*HOMING_SEEK_TRAVEL;
+    found = mc_homing_move(target, settings.homing_seek_rate, true);
+  }
+  for (idx=0; found && idx<N_HOMING_LOCATE_CYCLE; idx++) {
+    target[X_AXIS] = sys.probe_position[X_AXIS]/settings.steps_per_deg[X_AXIS]-dir*settings.homing_pulloff;
+    mc_homing_move(target, settings.homing_seek_rate, false);
+    target[X_AXIS] += 2*dir*settings.homing_pulloff;
+    found = mc_homing_move(target, settings.homing_feed_rate, true);
+  }
+  if (sys.abort) { return; } // Return if system reset has been issued.
+
+  // No index found. The homing state identifies the source of the alarm.
+  if (!found) { 
+    sys.state = STATE_HOMING;
+    bit_true_atomic(sys.execute, EXEC_CRIT_EVENT);
+    protocol_execute_runtime();
+    return;
+  }
+
+  // Homing cycle complete! Set the index edge as machine zero and return to it.
+  sys.position[X_AXIS] -= sys.probe_position[X_AXIS];
+  sys.probe_position[X_AXIS] = 0;
+  plan_sync_position();
+  target[X_AXIS] = 0.0;
+  #ifdef USE_LINE_NUMBERS
+    mc_line(target, settings.homing_seek_rate, false, HOMING_CYCLE_LINE_NUMBER);
+  #else
+    mc_line(target, settings.homing_seek_rate, false);
+  #endif
+  bit_true_atomic(sys.execute, EXEC_CYCLE_START);
+  protocol_buffer_synchronize(); 
+  if (sys.abort) { return; } // Return if system reset has been issued.
+
+  // Gcode parser position was circumvented by the homing motions, so sync position now.
+  gc_sync_position();
+  sys.state = STATE_IDLE; // Set idle state after homing completes, also when no return was needed.
+  sys.auto_start = auto_start_state; // Restore run state before returning
+}
 
 
 // Perform tool length probe cycle. Requires probe switch.
@@ -300,7 +396,7 @@ void mc_homing_cycle()
   #endif
   
   // Activate the probing monitor in the stepper module.
-  sys.probe_state = PROBE_ACTIVE;
+  probe_activate();
 
   // Perform probing cycle. Wait here until probe is triggered or motion completes.
   bit_true_atomic(sys.execute, EXEC_CYCLE_START);
@@ -309,6 +405,11 @@ void mc_homing_cycle()
     if (sys.abort) { return; } // Check for system abort
   } while ((sys.state != STATE_IDLE) && (sys.state != STATE_QUEUED));
 
+  #ifdef PROBE_PIN_INTERRUPT
+    // The stepper stopped before the tick that would have latched the trigger position.
+    if (sys.probe_state == PROBE_LATCH) { probe_latch_position(); }
+  #endif
+
   // Probing motion complete. If the probe has not been triggered, error out.
   if (sys.probe_state == PROBE_ACTIVE) { bit_true_atomic(sys.execute, EXEC_CRIT_EVENT); }
   protocol_execute_runtime();   // Check and execute run-time commands
@@ -346,6 +447,145 @@ void mc_homing_cycle()
 }
 
 
+// Perform on-board scan sequence. Only '$S' executes this command. At each of the count positions,
+// every frame of the laser pattern is run in order: the lasers are set (digit 0 turns all lasers
+// off, digit n turns laser n on alone), a sync marker is sent and the exposure dwell is performed.
+// Then the turntable is stepped by step degrees and the next position is started once it arrives.
+// NOTE: There should be no motions in the buffer and Grbl must be in an idle state before
+// executing the scan cycle. The whole scan runs without any host round-trip per step.
+void mc_scan_cycle(float step, uint16_t count, float feed_rate, char *pattern, float exposure, uint8_t sync)
+{
+  if (sys.state == STATE_CHECK_MODE) { return; }
+
+  // Finish all queued commands and empty planner buffer before starting scan cycle.
+  protocol_buffer_synchronize();
+  if (sys.abort) { return; } // Return if system reset has been issued.
+  uint8_t auto_start_state = sys.auto_start; // Store run state
+
+  float target[N_AXIS];
+  memcpy(target,gc_state.position,sizeof(gc_state.position));
+
+  uint16_t n;
+  uint8_t frame, idx;
+  for (n=0; n<count; n++) {
+    // Run laser pattern frames at the current position.
+    for (frame=0; pattern[frame] != 0; frame++) {
+      for (idx=0; idx<N_LASER; idx++) {
+        laser_set(idx, (pattern[frame]-'1' == idx) ? LASER_ENABLE : LASER_DISABLE);
+      }
+      report_scan_marker(n, frame);
+      mc_dwell(exposure);
+      if (sys.abort) { return; } // Return if system reset has been issued.
+    }
+
+    // Step to the next position and wait until the motion completes.
+    target[X_AXIS] += step;
+    #ifdef USE_LINE_NUMBERS
+      mc_line(target, feed_rate, false, n);
+    #else
+      mc_line(target, feed_rate, false);
+    #endif
+    #ifdef SYNC_BUS
+      // Armed once the step is queued, so an edge that comes first can't be lost.
+      if (sync) { sync_arm(); }
+      else
+    #endif
+    bit_true_atomic(sys.execute, EXEC_CYCLE_START);
+    protocol_buffer_synchronize();
+    if (sys.abort) { return; } // Return if system reset has been issued.
+    gc_state.position[X_AXIS] = target[X_AXIS];
+  }
+
+  for (idx=0; idx<N_LASER; idx++) { laser_set(idx, LASER_DISABLE); }
+  sys.auto_start = auto_start_state; // Restore run state before returning
+}
+
+
+// Expands a move list into planner blocks. Each target is computed from the start position, so
+// the rounding errors of a long run don't add up. mc_line() holds off while the planner buffer is
+// full and keeps the runtime commands running meanwhile. The parser position follows each queued
+// move, so an abort or a later g-code line starts from the last queued target.
+void mc_line_repeat(float delta, uint16_t count, float feed_rate)
+{
+  float target[N_AXIS];
+  memcpy(target,gc_state.position,sizeof(gc_state.position));
+  float start = target[X_AXIS];
+
+  uint16_t n;
+  for (n=1; n<=count; n++) {
+    target[X_AXIS] = start + delta*n;
+    #ifdef USE_LINE_NUMBERS
+      mc_line(target, feed_rate, false, n);
+    #else
+      mc_line(target, feed_rate, false);
+    #endif
+    if (sys.abort) { return; } // Bail on system abort. The position is resynced by the reset.
+    gc_state.position[X_AXIS] = target[X_AXIS];
+  }
+}
+
+
+// Continuous rotation jog state. The blocks are block_degrees long, and count of them are kept
+// queued to cover the stopping distance at the jog rate.
+static float jog_target;    // Target of the last queued block in degrees
+static float jog_block_degrees;
+static uint8_t jog_block_count;
+
+
+// Starts, changes or stops the continuous rotation jog. Only '$J' executes this command. Instead of
+// a program of many short blocks, the jog queues a few long blocks at a time at the jog rate, that
+// the planner always plans to a stop at the end of the last one. New blocks are queued as the old
+// ones complete, so the table turns at the jog rate until the jog stops queueing them, and then
+// decelerates to a stop at the end of the queued blocks. A rate change joins the queued blocks with
+// a controlled acceleration through the planner junction. A reversal stops at the junction first.
+// NOTE: G-code lines are refused during a jog. Feed hold and cycle start work as in any cycle.
+void mc_jog(float rate)
+{
+  if (rate == 0.0) {
+    // Stop queueing. The parser position is where the last queued block stops.
+    if (sys.jog_rate != 0.0) { gc_state.position[X_AXIS] = jog_target; }
+    sys.jog_rate = 0.0;
+    return;
+  }
+
+  if (sys.jog_rate == 0.0) { // Start jog
+    jog_target = gc_state.position[X_AXIS];
+    bit_true_atomic(sys.execute, EXEC_CYCLE_START);
+  }
+  if (rate > settings.max_rate[X_AXIS]) { rate = settings.max_rate[X_AXIS]; }
+  else if (rate < -settings.max_rate[X_AXIS]) { rate = -settings.max_rate[X_AXIS]; }
+  sys.jog_rate = rate;
+
+  // Stopping distance rate^2/(2*acceleration) over the block length rate*JOG_BLOCK_TIME, plus the
+  // block being executed.
+  rate = fabs(rate);
+  jog_block_degrees = rate*(JOG_BLOCK_TIME/60.0);
+  jog_block_count = min(ceil((30.0/JOG_BLOCK_TIME)*rate/settings.acceleration[X_AXIS])+1, BLOCK_BUFFER_SIZE-1);
+  mc_jog_execute();
+}
+
+
+void mc_jog_execute()
+{
+  if (sys.jog_rate == 0.0) { return; }
+
+  // Queue straight into the planner. mc_line() would check runtime commands and call back here.
+  float target[N_AXIS];
+  memcpy(target,gc_state.position,sizeof(gc_state.position));
+  while (plan_get_block_buffer_count() < jog_block_count) {
+    if (sys.jog_rate > 0.0) { jog_target += jog_block_degrees; }
+    else { jog_target -= jog_block_degrees; }
+    target[X_AXIS] = jog_target;
+    #ifdef USE_LINE_NUMBERS
+      plan_buffer_line(target, fabs(sys.jog_rate), false, JOG_LINE_NUMBER);
+    #else
+      plan_buffer_line(target, fabs(sys.jog_rate), false);
+    #endif
+  }
+  if (!sys.state) { sys.state = STATE_QUEUED; }
+}
+
+
 // Method to ready the system to reset by setting the runtime reset command and killing any
 // active processes in the system. This also checks if a system reset is issued while Grbl
 // is in a motion state. If so, kills the steppers and sets the system alarm to flag position
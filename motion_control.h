@@ -28,6 +28,7 @@
 #define motion_control_h
 
 #define HOMING_CYCLE_LINE_NUMBER -1
+#define JOG_LINE_NUMBER -2
 
 // Execute linear motion in absolute millimeter coordinates. Feed rate given in millimeters/second
 // unless invert_feed_rate is true. Then the feed_rate means that the motion should be completed in
@@ -53,7 +54,18 @@ void mc_arc(float *position, float *target, float *offset, float radius, float f
 // Dwell for a specific number of seconds
 void mc_dwell(float seconds);
 
-// Perform homing cycle to locate machine zero. Requires limit switches.
+#ifdef LASER_PULSE
+// Fires a timed pulse of the laser (0-3), and of the next one after it, once the buffered motions
+// are complete. Returns when the lasers are off again.
+void mc_laser_pulse(uint8_t id, uint32_t usec, uint8_t next);
+#endif
+
+#ifdef SYNC_BUS
+// Holds the motions that follow for the sync input edge, once the buffered motions are complete.
+void mc_sync();
+#endif
+
+// Perform homing cycle to locate machine zero. Requires an index sensor on the probe pin.
 void mc_homing_cycle();
 
 // Perform tool length probe cycle. Requires probe switch.
@@ -63,6 +75,22 @@ void mc_probe_cycle(float *target, float feed_rate, uint8_t invert_feed_rate, in
 void mc_probe_cycle(float *target, float feed_rate, uint8_t invert_feed_rate);
 #endif
 
+// Perform on-board scan sequence. Steps count times by step degrees, running the laser frame
+// pattern at every position. With sync set, each step waits for the sync input edge. Requires idle
+// state.
+void mc_scan_cycle(float step, uint16_t count, float feed_rate, char *pattern, float exposure, uint8_t sync);
+
+// Queues count linear moves of delta degrees each from the parser position, at feed_rate deg/min.
+// Waits for room in the planner buffer before each move, like a stream of g-code lines.
+void mc_line_repeat(float delta, uint16_t count, float feed_rate);
+
+// Starts the continuous rotation jog at rate deg/min, or changes the rate of a running jog. The
+// sign sets the direction. Zero rate stops it. Requires idle state to start.
+void mc_jog(float rate);
+
+// Queues the blocks of a running jog as the planner buffer empties. Called by the runtime protocol.
+void mc_jog_execute();
+
 // Performs system reset. If in motion state, kills all motion and sets system alarm.
 void mc_reset();
 
@@ -30,6 +30,10 @@
 
 #define MAX_INT_DIGITS 8 // Maximum number of digits in int32 (and float)
 
+// Decimal scale of the integer value by the number of decimal digits read.
+static const float read_float_scale[MAX_INT_DIGITS+1] PROGMEM = 
+  { 1.0, 1.0E-1, 1.0E-2, 1.0E-3, 1.0E-4, 1.0E-5, 1.0E-6, 1.0E-7, 1.0E-8 };
+
 
 // Extracts a floating point value from a string. The following code is based loosely on
 // the avr-libc strtod() function by Michael Stumpf and Dmitry Xmelkov and many freely
@@ -85,15 +89,11 @@ uint8_t read_float(char *line, uint8_t *char_counter, float *float_ptr)
   float fval;
   fval = (float)intval;
   
-  // Apply decimal. Should perform no more than two floating point multiplications for the
-  // expected range of E0 to E-4.
+  // Apply decimal. The decimal digits are all within the integer, so a single floating point
+  // multiplication by the table scale applies them. Integers need none.
   if (fval != 0) {
-    while (exp <= -2) {
-      fval *= 0.01; 
-      exp += 2;
-    }
     if (exp < 0) { 
-      fval *= 0.1; 
+      fval *= pgm_read_float(&read_float_scale[-exp]); 
     } else if (exp > 0) {
       do {
         fval *= 10.0;
@@ -147,3 +147,25 @@ void delay_us(uint32_t us)
 
 // Simple hypotenuse computation function.
 float hypot_f(float x, float y) { return(sqrt(x*x + y*y)); }
+
+
+#ifdef FIXED_POINT_PLANNER
+  // Bit-by-bit integer square root. Only shifts and adds, so it is cheap on the AVR compared to
+  // the float sqrt() and is exact for the whole 32-bit range.
+  uint16_t isqrt(uint32_t x)
+  {
+    uint32_t root = 0;
+    uint32_t place = 1UL << 30; // Highest power of four of a 32-bit value
+    while (place > x) { place >>= 2; }
+    while (place) {
+      if (x >= root + place) {
+        x -= root + place;
+        root = (root >> 1) + place;
+      } else {
+        root >>= 1;
+      }
+      place >>= 2;
+    }
+    return(root);
+  }
+#endif
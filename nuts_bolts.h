@@ -72,4 +72,9 @@ void delay_us(uint32_t us);
 // Computes hypotenuse, avoiding avr-gcc's bloated version and the extra error checking.
 float hypot_f(float x, float y);
 
+#ifdef FIXED_POINT_PLANNER
+  // Computes the integer square root, rounded down. Used by the fixed-point planner in place of sqrt().
+  uint16_t isqrt(uint32_t x);
+#endif
+
 #endif
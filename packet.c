@@ -0,0 +1,135 @@
+/*
+  packet.c - binary command protocol
+  Part of Horus Firmware
+
+  Copyright (c) 2014-2015 Mundo Reader S.L.
+
+  Horus Firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Horus Firmware is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Horus Firmware.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* 
+  The binary protocol is a compact alternative to the g-code parser for the commands a scan
+  streams the most. A packet is 7 bytes instead of the ~12-20 bytes of a g-code line and skips
+  the parser's word parsing, float conversions and modal group checks, while executing the same
+  motion control, laser and motor methods. The parser state is kept in sync, so packets and 
+  g-code lines may be freely mixed in the same stream.
+*/
+
+#include "system.h"
+#include "settings.h"
+#include "gcode.h"
+#include "motion_control.h"
+#include "stepper.h"
+#include "protocol.h"
+#include "laser_control.h"
+#include "ldr.h"
+#include "report.h"
+#include "serial.h"
+#include "packet.h"
+
+
+// Computes the CRC8 (polynomial 0x07) of the given bytes.
+static uint8_t packet_crc8(uint8_t *data, uint8_t length)
+{
+  uint8_t crc = 0;
+  uint8_t i;
+  while (length--) {
+    crc ^= *data++;
+    for (i=0; i<8; i++) {
+      if (crc & 0x80) { crc = (crc << 1) ^ 0x07; }
+      else { crc <<= 1; }
+    }
+  }
+  return(crc);
+}
+
+
+// Sends a packet to the host, framed with the start byte and the CRC.
+void packet_write(uint8_t *data, uint8_t length)
+{
+  uint8_t crc = packet_crc8(data, length);
+  serial_write(PACKET_START);
+  while (length--) { serial_write(*data++); }
+  serial_write(crc);
+}
+
+
+// Relative move in steps queued by PACKET_CMD_MOVE_REPEAT.
+static int32_t packet_move_delta;
+
+
+// Executes one binary packet. Data points to the command byte, followed by the value and CRC.
+uint8_t packet_execute(uint8_t *data)
+{
+  if (packet_crc8(data, PACKET_SIZE-2) != data[PACKET_SIZE-2]) { return(STATUS_BAD_PACKET); }
+
+  int32_t value = (int32_t)( (uint32_t)data[1] | ((uint32_t)data[2] << 8) |
+                             ((uint32_t)data[3] << 16) | ((uint32_t)data[4] << 24) );
+
+  switch (data[0]) {
+    case PACKET_CMD_LINE:
+      if (gc_state.feed_rate == 0.0) { return(STATUS_GCODE_UNDEFINED_FEED_RATE); }
+      if (sys.jog_rate != 0.0) { return(STATUS_IDLE_ERROR); }
+      gc_state.modal.motion = MOTION_MODE_LINEAR;
+      gc_state.position[X_AXIS] = value/settings.steps_per_deg[X_AXIS];
+      #ifdef USE_LINE_NUMBERS
+        mc_line(gc_state.position, gc_state.feed_rate, false, 0);
+      #else
+        mc_line(gc_state.position, gc_state.feed_rate, false);
+      #endif
+      break;
+    case PACKET_CMD_FEED_RATE:
+      if (value < 0) { return(STATUS_NEGATIVE_VALUE); }
+      gc_state.feed_rate = value*(60/1000.0); // Convert 0.001 deg/sec to deg/min
+      break;
+    case PACKET_CMD_LASER_OFF: case PACKET_CMD_LASER_ON:
+      if ((value < 1) || (value > N_LASER)) { return(STATUS_INVALID_STATEMENT); }
+      gc_state.modal.laser = (data[0] == PACKET_CMD_LASER_ON) ? LASER_ENABLE : LASER_DISABLE;
+      gc_state.tool = value;
+      laser_run(value, gc_state.modal.laser);
+      break;
+    case PACKET_CMD_LDR:
+      if ((value < 0) || (value > 7)) { return(STATUS_INVALID_STATEMENT); }
+      #ifdef LDR_READ_QUEUE
+        ldr_read_queue(value, -1);
+      #else
+        print_ldr(value);
+      #endif
+      break;
+    case PACKET_CMD_MOTOR_ENABLE:
+      gc_state.modal.motor = MOTOR_ENABLE;
+      st_disable_on_idle(false);
+      st_wake_up();
+      break;
+    case PACKET_CMD_MOTOR_DISABLE:
+      gc_state.modal.motor = MOTOR_DISABLE;
+      protocol_buffer_synchronize(); // Finish queued motions before releasing the motor.
+      st_disable_on_idle(true);
+      st_go_idle();
+      break;
+    case PACKET_CMD_MOVE_DELTA:
+      packet_move_delta = value;
+      break;
+    case PACKET_CMD_MOVE_REPEAT:
+      if ((value < 1) || (value > 0xFFFF) || (packet_move_delta == 0)) { return(STATUS_INVALID_STATEMENT); }
+      if (gc_state.feed_rate == 0.0) { return(STATUS_GCODE_UNDEFINED_FEED_RATE); }
+      if (sys.jog_rate != 0.0) { return(STATUS_IDLE_ERROR); }
+      gc_state.modal.motion = MOTION_MODE_LINEAR;
+      mc_line_repeat(packet_move_delta/settings.steps_per_deg[X_AXIS], value, gc_state.feed_rate);
+      break;
+    default:
+      return(STATUS_GCODE_UNSUPPORTED_COMMAND);
+  }
+  return(STATUS_OK);
+}
@@ -0,0 +1,50 @@
+/*
+  packet.h - binary command protocol
+  Part of Horus Firmware
+
+  Copyright (c) 2014-2015 Mundo Reader S.L.
+
+  Horus Firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Horus Firmware is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Horus Firmware.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef packet_h
+#define packet_h
+
+// Binary packet framing: [PACKET_START][command][value, int32 little-endian][crc8]
+// The CRC8 (polynomial 0x07, initial value 0) covers the command and value bytes.
+#define PACKET_START 0xA5
+#define PACKET_SIZE  7 // Total packet size in bytes, start byte included.
+
+// Define packet commands. The value meaning depends on the command.
+#define PACKET_CMD_LINE          0x01 // G1. Value: absolute machine target in steps.
+#define PACKET_CMD_FEED_RATE     0x02 // F. Value: feed rate in 0.001 deg/sec.
+#define PACKET_CMD_LASER_OFF     0x03 // M70. Value: laser number (1-N_LASER).
+#define PACKET_CMD_LASER_ON      0x04 // M71. Value: laser number (1-N_LASER).
+#define PACKET_CMD_LDR           0x05 // M50. Value: sensor channel.
+#define PACKET_CMD_MOTOR_ENABLE  0x06 // M17. Value: ignored.
+#define PACKET_CMD_MOTOR_DISABLE 0x07 // M18. Value: ignored.
+#define PACKET_CMD_MOVE_DELTA    0x08 // Sets the move of PACKET_CMD_MOVE_REPEAT. Value: relative move in steps.
+#define PACKET_CMD_MOVE_REPEAT   0x09 // Queues the move count times. Value: count (1-65535).
+
+// Define packets sent to the host. Their type has the high bit set, and their payload varies.
+// Framing: [PACKET_START][type][payload][crc8], with the CRC8 over the type and payload bytes.
+#define PACKET_REPORT_STATUS     0x80 // Status report. See report_realtime_status().
+
+// Executes one binary packet. Data points to the bytes following the start byte. Returns a status code.
+uint8_t packet_execute(uint8_t *data);
+
+// Sends a packet to the host. Data points to the type byte, followed by length-1 payload bytes.
+void packet_write(uint8_t *data, uint8_t length);
+
+#endif
@@ -30,6 +30,8 @@
 #include "protocol.h"
 #include "stepper.h"
 #include "settings.h"
+#include "laser_control.h"
+#include "ldr.h"
 
 
 #define SOME_LARGE_VALUE 1.0E+38 // Used by rapids and acceleration maximization calculations. Just needs
@@ -46,12 +48,96 @@ typedef struct {
   int32_t position[N_AXIS];          // The planner position of the tool in absolute steps. Kept separate
                                      // from g-code position for movements requiring multiple line motions,
                                      // i.e. arcs, canned cycles, and backlash compensation.
-  float previous_unit_vec[N_AXIS];   // Unit vector of previous path line segment
-  float previous_nominal_speed_sqr;  // Nominal speed of previous path line segment
+  #if defined(COMPACT_PLANNER_BLOCK)
+    uint8_t previous_direction_bits;     // Direction of previous path line segment
+    uint32_t acceleration;               // Acceleration of all blocks in the buffer (step/sec^2)
+    uint32_t junction_speed_sqr;         // Speed limit of a reversal junction (step/sec)^2
+  #elif defined(FIXED_POINT_PLANNER)
+    uint8_t previous_direction_bits;     // Direction of previous path line segment
+    uint32_t previous_nominal_speed_sqr; // Nominal speed of previous path line segment
+  #else
+    float previous_unit_vec[N_AXIS];   // Unit vector of previous path line segment
+    float previous_nominal_speed_sqr;  // Nominal speed of previous path line segment
+  #endif
 } planner_t;
 static planner_t pl;
 
 
+#ifdef FIXED_POINT_PLANNER
+  typedef uint32_t plan_speed_sqr_t; // (step/sec)^2
+
+  #ifdef COMPACT_PLANNER_BLOCK
+    // Junction types of the compact block. Stands for the junction speed limit of the full block.
+    #define PLAN_JUNCTION_STOP 0     // Starting from rest
+    #define PLAN_JUNCTION_STRAIGHT 1 // Same direction. Only limited by the nominal speeds.
+    #define PLAN_JUNCTION_REVERSAL 2 // Limited by the minimum junction speed
+  #endif
+
+  // Sets the block nominal speed with the feed override, within the max speed.
+  static void plan_update_nominal_speed(plan_block_t *block, uint32_t max_speed)
+  {
+    uint32_t nominal_speed = ((uint32_t)block->programmed_speed*sys.f_override)/100;
+    if (nominal_speed == 0) { nominal_speed = 1; } // Prevents step generation round-off condition.
+    else if (nominal_speed > max_speed) { nominal_speed = max_speed; }
+    #ifdef COMPACT_PLANNER_BLOCK
+      block->nominal_speed = nominal_speed;
+    #else
+      block->nominal_speed_sqr = nominal_speed*nominal_speed;
+    #endif
+  }
+
+
+  // Returns the X axis max rate in (step/sec), within the planner limit.
+  static uint32_t plan_compute_max_speed()
+  {
+    uint32_t max_speed = lround(settings.max_rate[X_AXIS]*settings.steps_per_deg[X_AXIS]*(1.0/60.0));
+    return(min(max_speed, PLAN_MAX_SPEED));
+  }
+
+
+  // Returns the X axis acceleration in (step/sec^2), within the planner limit.
+  uint32_t plan_compute_acceleration()
+  {
+    uint32_t acceleration = lround(settings.acceleration[X_AXIS]*settings.steps_per_deg[X_AXIS]*(1.0/3600.0));
+    if (acceleration == 0) { return(1); }
+    return(min(acceleration, PLAN_MAX_ACCELERATION));
+  }
+
+
+  // Returns the speed squared change over the remaining block distance at the block acceleration,
+  // 2*acceleration*distance. Saturated at the speed limit, which plans the same as any larger value
+  // and keeps the planner sums within 32 bits.
+  static uint32_t plan_compute_ramp_speed_sqr(plan_block_t *block)
+  {
+    uint32_t acceleration = plan_block_acceleration(block);
+    if (block->steps_remaining >= PLAN_MAX_SPEED_SQR/(2*acceleration)) { return(PLAN_MAX_SPEED_SQR); }
+    return(2*acceleration*block->steps_remaining);
+  }
+#else
+  typedef float plan_speed_sqr_t; // (deg/min)^2
+
+  // Sets the block nominal speed squared with the feed override, within the max rate.
+  // NOTE: Only the X axis is wired, so overrides above 100% are limited by its max rate.
+  static void plan_update_nominal_speed(plan_block_t *block, float max_rate)
+  {
+    float nominal_speed = block->programmed_rate*(0.01*sys.f_override);
+    if (nominal_speed < MINIMUM_FEED_RATE) { nominal_speed = MINIMUM_FEED_RATE; }
+    else if (nominal_speed > max_rate) { nominal_speed = max_rate; }
+    block->nominal_speed_sqr = nominal_speed*nominal_speed;
+  }
+
+
+  // Returns the X axis max rate in (deg/min).
+  static float plan_compute_max_speed() { return(settings.max_rate[X_AXIS]); }
+
+  // Returns the speed squared change over the remaining block distance at the block acceleration.
+  static float plan_compute_ramp_speed_sqr(plan_block_t *block)
+  {
+    return(2*block->acceleration*block->degrees);
+  }
+#endif
+
+
 // Returns the index of the next block in the ring buffer. Also called by stepper segment buffer.
 uint8_t plan_next_block_index(uint8_t block_index) 
 {
@@ -70,6 +156,31 @@ static uint8_t plan_prev_block_index(uint8_t block_index)
 }
 
 
+#ifdef COMPACT_PLANNER_BLOCK
+  // Returns the maximum entry speed of the block from its junction type and the nominal speeds of
+  // the block and the previous one.
+  // NOTE: Only called for blocks after the planned pointer, so the previous block is always in the buffer.
+  static uint32_t plan_compute_max_entry_speed_sqr(uint8_t block_index)
+  {
+    plan_block_t *block = &block_buffer[block_index];
+    if (block->junction == PLAN_JUNCTION_STOP) { return(0); }
+    uint32_t max_entry_speed_sqr = min(plan_block_nominal_speed_sqr(block),
+                                       plan_block_nominal_speed_sqr(&block_buffer[plan_prev_block_index(block_index)]));
+    if (block->junction == PLAN_JUNCTION_REVERSAL) { return(min(max_entry_speed_sqr, pl.junction_speed_sqr)); }
+    return(max_entry_speed_sqr);
+  }
+
+
+  uint32_t plan_get_acceleration() { return(pl.acceleration); }
+#else
+  // Returns the maximum entry speed of the block, computed when it was buffered.
+  static plan_speed_sqr_t plan_compute_max_entry_speed_sqr(uint8_t block_index)
+  {
+    return(block_buffer[block_index].max_entry_speed_sqr);
+  }
+#endif
+
+
 /*                            PLANNER SPEED DEFINITION                                              
                                      +--------+   <- current->nominal_speed
                                     /          \                                
@@ -146,12 +257,13 @@ static void planner_recalculate()
   // Reverse Pass: Coarsely maximize all possible deceleration curves back-planning from the last
   // block in buffer. Cease planning when the last optimal planned or tail pointer is reached.
   // NOTE: Forward pass will later refine and correct the reverse pass to create an optimal plan.
-  float entry_speed_sqr;
+  plan_speed_sqr_t entry_speed_sqr;
   plan_block_t *next;
   plan_block_t *current = &block_buffer[block_index];
 
   // Calculate maximum entry speed for last block in buffer, where the exit speed is always zero.
-  current->entry_speed_sqr = min( current->max_entry_speed_sqr, 2*current->acceleration*current->degrees);
+  current->entry_speed_sqr = min( plan_compute_max_entry_speed_sqr(block_index), plan_compute_ramp_speed_sqr(current));
+  plan_speed_sqr_t max_entry_speed_sqr;
   
   block_index = plan_prev_block_index(block_index);
   if (block_index == block_buffer_planned) { // Only two plannable blocks in buffer. Reverse pass complete.
@@ -161,18 +273,19 @@ static void planner_recalculate()
     while (block_index != block_buffer_planned) { 
       next = current;
       current = &block_buffer[block_index];
+      max_entry_speed_sqr = plan_compute_max_entry_speed_sqr(block_index);
       block_index = plan_prev_block_index(block_index);
 
       // Check if next block is the tail block(=planned block). If so, update current stepper parameters.
       if (block_index == block_buffer_tail) { st_update_plan_block_parameters(); } 
 
       // Compute maximum entry speed decelerating over the current block from its exit speed.
-      if (current->entry_speed_sqr != current->max_entry_speed_sqr) {
-        entry_speed_sqr = next->entry_speed_sqr + 2*current->acceleration*current->degrees;
-        if (entry_speed_sqr < current->max_entry_speed_sqr) {
+      if (current->entry_speed_sqr != max_entry_speed_sqr) {
+        entry_speed_sqr = next->entry_speed_sqr + plan_compute_ramp_speed_sqr(current);
+        if (entry_speed_sqr < max_entry_speed_sqr) {
           current->entry_speed_sqr = entry_speed_sqr;
         } else {
-          current->entry_speed_sqr = current->max_entry_speed_sqr;
+          current->entry_speed_sqr = max_entry_speed_sqr;
         }
       }
     }
@@ -190,7 +303,7 @@ static void planner_recalculate()
     // pointer forward, since everything before this is all optimal. In other words, nothing
     // can improve the plan from the buffer tail to the planned pointer by logic.
     if (current->entry_speed_sqr < next->entry_speed_sqr) {
-      entry_speed_sqr = current->entry_speed_sqr + 2*current->acceleration*current->degrees;
+      entry_speed_sqr = current->entry_speed_sqr + plan_compute_ramp_speed_sqr(current);
       // If true, current block is full-acceleration and we can move the planned pointer forward.
       if (entry_speed_sqr < next->entry_speed_sqr) {
         next->entry_speed_sqr = entry_speed_sqr; // Always <= max_entry_speed_sqr. Backward pass sets this.
@@ -202,7 +315,7 @@ static void planner_recalculate()
     // point in the buffer. When the plan is bracketed by either the beginning of the
     // buffer and a maximum entry speed or two maximum entry speeds, every block in between
     // cannot logically be further improved. Hence, we don't have to recompute them anymore.
-    if (next->entry_speed_sqr == next->max_entry_speed_sqr) { block_buffer_planned = block_index; }
+    if (next->entry_speed_sqr == plan_compute_max_entry_speed_sqr(block_index)) { block_buffer_planned = block_index; }
     block_index = plan_next_block_index( block_index );
   } 
 }
@@ -236,12 +349,21 @@ plan_block_t *plan_get_current_block()
 }
 
 
-float plan_get_exec_block_exit_speed()
-{
-  uint8_t block_index = plan_next_block_index(block_buffer_tail);
-  if (block_index == block_buffer_head) { return( 0.0 ); }
-  return( sqrt( block_buffer[block_index].entry_speed_sqr ) ); 
-}
+#ifdef FIXED_POINT_PLANNER
+  uint32_t plan_get_exec_block_exit_speed()
+  {
+    uint8_t block_index = plan_next_block_index(block_buffer_tail);
+    if (block_index == block_buffer_head) { return(0); }
+    return( isqrt( block_buffer[block_index].entry_speed_sqr ) );
+  }
+#else
+  float plan_get_exec_block_exit_speed()
+  {
+    uint8_t block_index = plan_next_block_index(block_buffer_tail);
+    if (block_index == block_buffer_head) { return( 0.0 ); }
+    return( sqrt( block_buffer[block_index].entry_speed_sqr ) ); 
+  }
+#endif
 
 
 // Returns the availability status of the block ring buffer. True, if full.
@@ -270,131 +392,234 @@ uint8_t plan_check_full_buffer()
 {
   // Prepare and initialize new block
   plan_block_t *block = &block_buffer[block_buffer_head];
-  block->step_event_count = 0;
-  block->degrees = 0;
+  #ifndef COMPACT_PLANNER_BLOCK
+    block->step_event_count = 0;
+  #endif
   block->direction_bits = 0;
-  block->acceleration = SOME_LARGE_VALUE; // Scaled down to maximum acceleration later
+  #ifndef FIXED_POINT_PLANNER
+    block->degrees = 0;
+    block->acceleration = SOME_LARGE_VALUE; // Scaled down to maximum acceleration later
+  #endif
   #ifdef USE_LINE_NUMBERS
     block->line_number = line_number;
   #endif
+  #ifdef LASER_MOTION_SYNC
+    block->laser_state = laser_target;
+  #endif
+  #ifdef LDR_READ_QUEUE
+    block->ldr_read_mark = ldr_read_head;
+  #endif
 
-  // Compute and store initial move distance data.
-  // TODO: After this for-loop, we don't touch the stepper algorithm data. Might be a good idea
-  // to try to keep these types of things completely separate from the planner for portability.
-  int32_t target_steps[N_AXIS];
-  float unit_vec[N_AXIS], delta_deg;
-  uint8_t idx;
-  for (idx=0; idx<N_AXIS; idx++) {
-    // Calculate target position in absolute steps. This conversion should be consistent throughout.
-    target_steps[idx] = lround(target[idx]*settings.steps_per_deg[idx]);
+  #ifdef FIXED_POINT_PLANNER
+    // Single rotary axis. Only the X axis is planned, so the block distance is its step count and
+    // its settings are the block limits. The other axes are held at the planner position.
+    int32_t target_steps[N_AXIS];
+    memcpy(target_steps, pl.position, sizeof(target_steps)); // target_steps[] = pl.position[]
+    float steps_per_deg = settings.steps_per_deg[X_AXIS];
+    target_steps[X_AXIS] = lround(target[X_AXIS]*steps_per_deg);
+    uint32_t step_event_count = labs(target_steps[X_AXIS]-pl.position[X_AXIS]);
+    #ifndef SINGLE_AXIS_STEPPER
+      clear_vector(block->steps);
+      block->steps[X_AXIS] = step_event_count;
+    #endif
+    #ifndef COMPACT_PLANNER_BLOCK
+      block->step_event_count = step_event_count;
+    #endif
+    block->steps_remaining = step_event_count;
+    if (target_steps[X_AXIS] < pl.position[X_AXIS]) { block->direction_bits |= get_direction_pin_mask(X_AXIS); }
+
+    // Bail if this is a zero-length block. Highly unlikely to occur.
+    if (step_event_count == 0) { return; }
+
+    // Adjust feed_rate value to deg/min depending on type of rate input (normal, inverse time, or rapids)
+    if (feed_rate < 0) { feed_rate = settings.max_rate[X_AXIS]; }
+    else if (invert_feed_rate) { feed_rate = (step_event_count/steps_per_deg)/feed_rate; }
+    if (feed_rate < MINIMUM_FEED_RATE) { feed_rate = MINIMUM_FEED_RATE; }
+    feed_rate = min(feed_rate,settings.max_rate[X_AXIS]);
+
+    // Convert the speed and acceleration limits to step units once per block. The planner and the
+    // segment prep only work with integers from here on.
+    uint32_t max_speed = plan_compute_max_speed();
+    block->programmed_speed = min(lround(feed_rate*steps_per_deg*(1.0/60.0)), max_speed);
+    plan_update_nominal_speed(block, max_speed); // Always > 0
+    uint32_t acceleration = plan_compute_acceleration();
+    uint32_t junction_speed = lround(MINIMUM_JUNCTION_SPEED*steps_per_deg*(1.0/60.0));
+
+  #ifdef COMPACT_PLANNER_BLOCK
+    // Every queued block shares the planner acceleration. When it changes, the whole buffer is
+    // replanned with the new value, like for a feed override.
+    uint8_t replan = (acceleration != pl.acceleration);
+    pl.acceleration = acceleration;
+    pl.junction_speed_sqr = min(junction_speed*junction_speed, PLAN_MAX_SPEED_SQR);
+
+    // The junction limit and maximum entry speed are derived from the junction type while planning.
+    if (block_buffer_head == block_buffer_tail) {
+      block->entry_speed_sqr = 0; // Starting from rest. Enforce start from zero velocity.
+      block->junction = PLAN_JUNCTION_STOP;
+    } else if (block->direction_bits == pl.previous_direction_bits) {
+      block->junction = PLAN_JUNCTION_STRAIGHT;
+    } else {
+      block->junction = PLAN_JUNCTION_REVERSAL;
+    }
+    pl.previous_direction_bits = block->direction_bits;
+
+  #else
+    block->acceleration = acceleration;
+
+    if (block_buffer_head == block_buffer_tail) {
+      // Initialize block entry speed as zero. Assume it will be starting from rest. Planner will correct this later.
+      block->entry_speed_sqr = 0;
+      block->max_junction_speed_sqr = 0; // Starting from rest. Enforce start from zero velocity.
+    } else if (block->direction_bits == pl.previous_direction_bits) {
+      // Straight junction. Continuing in the same direction is only limited by the nominal speeds.
+      block->max_junction_speed_sqr = PLAN_MAX_SPEED_SQR;
+    } else {
+      // Reversal. The junction deviation model reduces to the minimum junction speed here.
+      block->max_junction_speed_sqr = min(junction_speed*junction_speed, PLAN_MAX_SPEED_SQR);
+    }
+
+    // Compute the junction maximum entry based on the minimum of the junction speed and neighboring nominal speeds.
+    block->max_entry_speed_sqr = min(block->max_junction_speed_sqr,
+                                     min(block->nominal_speed_sqr,pl.previous_nominal_speed_sqr));
+
+    // Update previous path direction and nominal speed (squared)
+    pl.previous_direction_bits = block->direction_bits;
+    pl.previous_nominal_speed_sqr = block->nominal_speed_sqr;
+  #endif
+
+  #else
+    // Compute and store initial move distance data.
+    // TODO: After this for-loop, we don't touch the stepper algorithm data. Might be a good idea
+    // to try to keep these types of things completely separate from the planner for portability.
+    int32_t target_steps[N_AXIS];
+    float unit_vec[N_AXIS], delta_deg;
+    uint8_t idx;
+    for (idx=0; idx<N_AXIS; idx++) {
+      // Calculate target position in absolute steps. This conversion should be consistent throughout.
+      target_steps[idx] = lround(target[idx]*settings.steps_per_deg[idx]);
   
-    // Number of steps for each axis and determine max step events
-    block->steps[idx] = labs(target_steps[idx]-pl.position[idx]);
-    block->step_event_count = max(block->step_event_count, block->steps[idx]);
+      // Number of steps for each axis and determine max step events
+      block->steps[idx] = labs(target_steps[idx]-pl.position[idx]);
+      block->step_event_count = max(block->step_event_count, block->steps[idx]);
     
-    // Compute individual axes distance for move and prep unit vector calculations.
-    // NOTE: Computes true distance from converted step values.
-    delta_deg = (target_steps[idx] - pl.position[idx])/settings.steps_per_deg[idx];
-    unit_vec[idx] = delta_deg; // Store unit vector numerator. Denominator computed later.
+      // Compute individual axes distance for move and prep unit vector calculations.
+      // NOTE: Computes true distance from converted step values.
+      delta_deg = (target_steps[idx] - pl.position[idx])/settings.steps_per_deg[idx];
+      unit_vec[idx] = delta_deg; // Store unit vector numerator. Denominator computed later.
         
-    // Set direction bits. Bit enabled always means direction is negative.
-    if (delta_deg < 0 ) { block->direction_bits |= get_direction_pin_mask(idx); }
+      // Set direction bits. Bit enabled always means direction is negative.
+      if (delta_deg < 0 ) { block->direction_bits |= get_direction_pin_mask(idx); }
     
-    // Incrementally compute total move distance by Euclidean norm. First add square of each term.
-    block->degrees += delta_deg*delta_deg;
-  }
-  block->degrees = sqrt(block->degrees); // Complete degrees calculation with sqrt()
+      // Incrementally compute total move distance by Euclidean norm. First add square of each term.
+      block->degrees += delta_deg*delta_deg;
+    }
+    block->degrees = sqrt(block->degrees); // Complete degrees calculation with sqrt()
   
-  // Bail if this is a zero-length block. Highly unlikely to occur.
-  if (block->step_event_count == 0) { return; } 
+    // Bail if this is a zero-length block. Highly unlikely to occur.
+    if (block->step_event_count == 0) { return; } 
   
-  // Adjust feed_rate value to deg/min depending on type of rate input (normal, inverse time, or rapids)
-  // TODO: Need to distinguish a rapids vs feed move for overrides. Some flag of some sort.
-  if (feed_rate < 0) { feed_rate = SOME_LARGE_VALUE; } // Scaled down to absolute max/rapids rate later
-  else if (invert_feed_rate) { feed_rate = block->degrees/feed_rate; }
-  if (feed_rate < MINIMUM_FEED_RATE) { feed_rate = MINIMUM_FEED_RATE; } // Prevents step generation round-off condition.
-
-  // Calculate the unit vector of the line move and the block maximum feed rate and acceleration scaled 
-  // down such that no individual axes maximum values are exceeded with respect to the line direction. 
-  // NOTE: This calculation assumes all axes are orthogonal (Cartesian) and works with ABC-axes,
-  // if they are also orthogonal/independent. Operates on the absolute value of the unit vector.
-  float inverse_unit_vec_value;
-  float inverse_degrees = 1.0/block->degrees;  // Inverse degrees to remove multiple float divides	
-  float junction_cos_theta = 0;
-  for (idx=0; idx<N_AXIS; idx++) {
-    if (unit_vec[idx] != 0) {  // Avoid divide by zero.
-      unit_vec[idx] *= inverse_degrees;  // Complete unit vector calculation
-      inverse_unit_vec_value = fabs(1.0/unit_vec[idx]); // Inverse to remove multiple float divides.
-
-      // Check and limit feed rate against max individual axis velocities and accelerations
-      feed_rate = min(feed_rate,settings.max_rate[idx]*inverse_unit_vec_value);
-      block->acceleration = min(block->acceleration,settings.acceleration[idx]*inverse_unit_vec_value);
-
-      // Incrementally compute cosine of angle between previous and current path. Cos(theta) of the junction
-      // between the current move and the previous move is simply the dot product of the two unit vectors, 
-      // where prev_unit_vec is negative. Used later to compute maximum junction speed.
-      junction_cos_theta -= pl.previous_unit_vec[idx] * unit_vec[idx];
+    // Adjust feed_rate value to deg/min depending on type of rate input (normal, inverse time, or rapids)
+    // TODO: Need to distinguish a rapids vs feed move for overrides. Some flag of some sort.
+    if (feed_rate < 0) { feed_rate = SOME_LARGE_VALUE; } // Scaled down to absolute max/rapids rate later
+    else if (invert_feed_rate) { feed_rate = block->degrees/feed_rate; }
+    if (feed_rate < MINIMUM_FEED_RATE) { feed_rate = MINIMUM_FEED_RATE; } // Prevents step generation round-off condition.
+
+    // Calculate the unit vector of the line move and the block maximum feed rate and acceleration scaled 
+    // down such that no individual axes maximum values are exceeded with respect to the line direction. 
+    // NOTE: This calculation assumes all axes are orthogonal (Cartesian) and works with ABC-axes,
+    // if they are also orthogonal/independent. Operates on the absolute value of the unit vector.
+    float inverse_unit_vec_value;
+    float inverse_degrees = 1.0/block->degrees;  // Inverse degrees to remove multiple float divides	
+    float junction_cos_theta = 0;
+    for (idx=0; idx<N_AXIS; idx++) {
+      if (unit_vec[idx] != 0) {  // Avoid divide by zero.
+        unit_vec[idx] *= inverse_degrees;  // Complete unit vector calculation
+        inverse_unit_vec_value = fabs(1.0/unit_vec[idx]); // Inverse to remove multiple float divides.
+
+        // Check and limit feed rate against max individual axis velocities and accelerations
+        feed_rate = min(feed_rate,settings.max_rate[idx]*inverse_unit_vec_value);
+        block->acceleration = min(block->acceleration,settings.acceleration[idx]*inverse_unit_vec_value);
+
+        // Incrementally compute cosine of angle between previous and current path. Cos(theta) of the junction
+        // between the current move and the previous move is simply the dot product of the two unit vectors, 
+        // where prev_unit_vec is negative. Used later to compute maximum junction speed.
+        junction_cos_theta -= pl.previous_unit_vec[idx] * unit_vec[idx];
+      }
     }
-  }
   
-  // TODO: Need to check this method handling zero junction speeds when starting from rest.
-  if (block_buffer_head == block_buffer_tail) {
+    // TODO: Need to check this method handling zero junction speeds when starting from rest.
+    if (block_buffer_head == block_buffer_tail) {
   
-    // Initialize block entry speed as zero. Assume it will be starting from rest. Planner will correct this later.
-    block->entry_speed_sqr = 0.0;
-    block->max_junction_speed_sqr = 0.0; // Starting from rest. Enforce start from zero velocity.
+      // Initialize block entry speed as zero. Assume it will be starting from rest. Planner will correct this later.
+      block->entry_speed_sqr = 0.0;
+      block->max_junction_speed_sqr = 0.0; // Starting from rest. Enforce start from zero velocity.
   
-  } else {
-    /* 
-       Compute maximum allowable entry speed at junction by centripetal acceleration approximation.
-       Let a circle be tangent to both previous and current path line segments, where the junction 
-       deviation is defined as the distance from the junction to the closest edge of the circle, 
-       colinear with the circle center. The circular segment joining the two paths represents the 
-       path of centripetal acceleration. Solve for max velocity based on max acceleration about the
-       radius of the circle, defined indirectly by junction deviation. This may be also viewed as 
-       path width or max_jerk in the previous grbl version. This approach does not actually deviate 
-       from path, but used as a robust way to compute cornering speeds, as it takes into account the
-       nonlinearities of both the junction angle and junction velocity.
-
-       NOTE: If the junction deviation value is finite, Grbl executes the motions in an exact path 
-       mode (G61). If the junction deviation value is zero, Grbl will execute the motion in an exact
-       stop mode (G61.1) manner. In the future, if continuous mode (G64) is desired, the math here
-       is exactly the same. Instead of motioning all the way to junction point, the machine will
-       just follow the arc circle defined here. The Arduino doesn't have the CPU cycles to perform
-       a continuous mode path, but ARM-based microcontrollers most certainly do. 
+    } else {
+      /* 
+         Compute maximum allowable entry speed at junction by centripetal acceleration approximation.
+         Let a circle be tangent to both previous and current path line segments, where the junction 
+         deviation is defined as the distance from the junction to the closest edge of the circle, 
+         colinear with the circle center. The circular segment joining the two paths represents the 
+         path of centripetal acceleration. Solve for max velocity based on max acceleration about the
+         radius of the circle, defined indirectly by junction deviation. This may be also viewed as 
+         path width or max_jerk in the previous grbl version. This approach does not actually deviate 
+         from path, but used as a robust way to compute cornering speeds, as it takes into account the
+         nonlinearities of both the junction angle and junction velocity.
+
+         NOTE: If the junction deviation value is finite, Grbl executes the motions in an exact path 
+         mode (G61). If the junction deviation value is zero, Grbl will execute the motion in an exact
+         stop mode (G61.1) manner. In the future, if continuous mode (G64) is desired, the math here
+         is exactly the same. Instead of motioning all the way to junction point, the machine will
+         just follow the arc circle defined here. The Arduino doesn't have the CPU cycles to perform
+         a continuous mode path, but ARM-based microcontrollers most certainly do. 
        
-       NOTE: The max junction speed is a fixed value, since machine acceleration limits cannot be
-       changed dynamically during operation nor can the line move geometry. This must be kept in
-       memory in the event of a feedrate override changing the nominal speeds of blocks, which can 
-       change the overall maximum entry speed conditions of all blocks.
-    */
-    // NOTE: Computed without any expensive trig, sin() or acos(), by trig half angle identity of cos(theta).
-    float sin_theta_d2 = sqrt(0.5*(1.0-junction_cos_theta)); // Trig half angle identity. Always positive.
-
-    // TODO: Technically, the acceleration used in calculation needs to be limited by the minimum of the
-    // two junctions. However, this shouldn't be a significant problem except in extreme circumstances.
-    block->max_junction_speed_sqr = max( MINIMUM_JUNCTION_SPEED*MINIMUM_JUNCTION_SPEED,
-                                 (block->acceleration * settings.junction_deviation * sin_theta_d2)/(1.0-sin_theta_d2) );
-  }
+         NOTE: The max junction speed is a fixed value, since machine acceleration limits cannot be
+         changed dynamically during operation nor can the line move geometry. This must be kept in
+         memory in the event of a feedrate override changing the nominal speeds of blocks, which can 
+         change the overall maximum entry speed conditions of all blocks.
+      */
+      // NOTE: Computed without any expensive trig, sin() or acos(), by trig half angle identity of cos(theta).
+      float sin_theta_d2 = sqrt(0.5*(1.0-junction_cos_theta)); // Trig half angle identity. Always positive.
+
+      // TODO: Technically, the acceleration used in calculation needs to be limited by the minimum of the
+      // two junctions. However, this shouldn't be a significant problem except in extreme circumstances.
+      block->max_junction_speed_sqr = max( MINIMUM_JUNCTION_SPEED*MINIMUM_JUNCTION_SPEED,
+                                   (block->acceleration * settings.junction_deviation * sin_theta_d2)/(1.0-sin_theta_d2) );
+    }
 
-  // Store block nominal speed
-  block->nominal_speed_sqr = feed_rate*feed_rate; // (deg/min). Always > 0
+    // Store block nominal speed
+    block->programmed_rate = feed_rate;
+    plan_update_nominal_speed(block, plan_compute_max_speed()); // (deg/min). Always > 0
   
-  // Compute the junction maximum entry based on the minimum of the junction speed and neighboring nominal speeds.
-  block->max_entry_speed_sqr = min(block->max_junction_speed_sqr, 
-                                   min(block->nominal_speed_sqr,pl.previous_nominal_speed_sqr));
+    // Compute the junction maximum entry based on the minimum of the junction speed and neighboring nominal speeds.
+    block->max_entry_speed_sqr = min(block->max_junction_speed_sqr, 
+                                     min(block->nominal_speed_sqr,pl.previous_nominal_speed_sqr));
   
-  // Update previous path unit_vector and nominal speed (squared)
-  memcpy(pl.previous_unit_vec, unit_vec, sizeof(unit_vec)); // pl.previous_unit_vec[] = unit_vec[]
-  pl.previous_nominal_speed_sqr = block->nominal_speed_sqr;
+    // Update previous path unit_vector and nominal speed (squared)
+    memcpy(pl.previous_unit_vec, unit_vec, sizeof(unit_vec)); // pl.previous_unit_vec[] = unit_vec[]
+    pl.previous_nominal_speed_sqr = block->nominal_speed_sqr;
     
+  #endif
+
   // Update planner position
   memcpy(pl.position, target_steps, sizeof(target_steps)); // pl.position[] = target_steps[]
 
   // New block is all set. Update buffer head and next buffer head indices.
   block_buffer_head = next_buffer_head;  
   next_buffer_head = plan_next_block_index(block_buffer_head);
+
+  #ifdef DIAGNOSTIC_COUNTERS
+    uint8_t block_count = plan_get_block_buffer_count();
+    if (block_count > diag.planner_max) { diag.planner_max = block_count; }
+  #endif
   
+  #ifdef COMPACT_PLANNER_BLOCK
+    if (replan) {
+      st_update_plan_block_parameters();
+      block_buffer_planned = block_buffer_tail;
+    }
+  #endif
+
   // Finish up by recalculating the plan with the new block.
   planner_recalculate();
 }
@@ -427,3 +652,27 @@ void plan_cycle_reinitialize()
   block_buffer_planned = block_buffer_tail;
   planner_recalculate();  
 }
+
+
+// Applies the feed override to the nominal speeds and the maximum entry speeds of all blocks in the
+// buffer, then replans from the current stepper speed. A reduction decelerates the executing block
+// in place, without flushing the buffer.
+void plan_update_feed_override()
+{
+  plan_speed_sqr_t max_speed = plan_compute_max_speed();
+  uint8_t block_index = block_buffer_tail;
+  plan_block_t *block;
+  while (block_index != block_buffer_head) {
+    block = &block_buffer[block_index];
+    plan_update_nominal_speed(block, max_speed);
+    #ifndef COMPACT_PLANNER_BLOCK
+      if (block_index == block_buffer_tail) { pl.previous_nominal_speed_sqr = block->nominal_speed_sqr; }
+      block->max_entry_speed_sqr = min(block->max_junction_speed_sqr,
+                                       min(block->nominal_speed_sqr,pl.previous_nominal_speed_sqr));
+      pl.previous_nominal_speed_sqr = block->nominal_speed_sqr;
+    #endif
+    block_index = plan_next_block_index(block_index);
+  }
+  plan_cycle_reinitialize();
+}
+
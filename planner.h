@@ -30,38 +30,105 @@
 
 // The number of linear motions that can be in the plan at any give time
 #ifndef BLOCK_BUFFER_SIZE
-  #ifdef USE_LINE_NUMBERS
+  #if defined(COMPACT_PLANNER_BLOCK)
+    // The compact block is under half the size of the full one, so twice the blocks fit in less RAM.
+    #ifdef USE_LINE_NUMBERS
+      #define BLOCK_BUFFER_SIZE 32
+    #else
+      #define BLOCK_BUFFER_SIZE 40
+    #endif
+  #elif defined(USE_LINE_NUMBERS)
     #define BLOCK_BUFFER_SIZE 16
   #else
     #define BLOCK_BUFFER_SIZE 18
   #endif
 #endif
 
+#ifdef FIXED_POINT_PLANNER
+  // Fixed-point planner limits. Capping the step rate keeps every speed squared below 2^31, so the
+  // planner can add two of them without overflowing 32 bits.
+  #define PLAN_MAX_SPEED 46340UL        // (step/sec)
+  #define PLAN_MAX_SPEED_SQR (PLAN_MAX_SPEED*PLAN_MAX_SPEED)
+  #define PLAN_MAX_ACCELERATION 4194303UL // (step/sec^2) Keeps the segment prep products within 32 bits.
+#endif
+
 // This struct stores a linear movement of a g-code block motion with its critical "nominal" values
 // are as specified in the source g-code. 
 typedef struct {
   // Fields used by the bresenham algorithm for tracing the line
   // NOTE: Used by stepper algorithm to execute the block correctly. Do not alter these values.
   uint8_t direction_bits;    // The direction bit set for this block (refers to *_DIRECTION_BIT in config.h)
-  uint32_t steps[N_AXIS];    // Step count along each axis
-  uint32_t step_event_count; // The maximum step axis count and number of steps required to complete this block. 
-
-  // Fields used by the motion planner to manage acceleration
-  float entry_speed_sqr;         // The current planned entry speed at block junction in (deg/min)^2
-  float max_entry_speed_sqr;     // Maximum allowable entry speed based on the minimum of junction limit and 
-                                 //   neighboring nominal speeds with overrides in (deg/min)^2
-  float max_junction_speed_sqr;  // Junction entry speed limit based on direction vectors in (deg/min)^2
-  float nominal_speed_sqr;       // Axis-limit adjusted nominal speed for this block in (deg/min)^2
-  float acceleration;            // Axis-limit adjusted line acceleration in (deg/min^2)
-  float degrees;                 // The remaining distance for this block to be executed in (deg)
-  // uint8_t max_override;       // Maximum override value based on axis speed limits
+  #ifndef SINGLE_AXIS_STEPPER
+    uint32_t steps[N_AXIS];  // Step count along each axis
+  #endif
+  #ifndef COMPACT_PLANNER_BLOCK
+    uint32_t step_event_count; // The maximum step axis count and number of steps required to complete this block. 
+  #endif
+
+  #if defined(COMPACT_PLANNER_BLOCK)
+    // Compact fields of the fixed-point planner. The remaining steps are the only step count, as a
+    // block is always loaded by the stepper before any of it executes. The speeds are stored as whole
+    // step rates, which PLAN_MAX_SPEED keeps within 16 bits, and squared when used. The junction
+    // limit and maximum entry speed are derived from the junction type and the neighboring nominal
+    // speeds. All blocks share the planner acceleration.
+    uint8_t junction;                // Junction type with the previous block (PLAN_JUNCTION_* in planner.c)
+    uint32_t entry_speed_sqr;        // The current planned entry speed at block junction in (step/sec)^2
+    uint16_t nominal_speed;          // Axis-limit adjusted nominal speed for this block in (step/sec)
+    uint16_t programmed_speed;       // Axis-limit adjusted programmed speed without the feed override in (step/sec)
+    uint32_t steps_remaining;        // The remaining distance for this block to be executed in (steps)
+  #elif defined(FIXED_POINT_PLANNER)
+    // Fields used by the fixed-point motion planner to manage acceleration. Only the X axis is
+    // planned, so distances are its steps and speeds are whole step rates.
+    uint32_t entry_speed_sqr;        // The current planned entry speed at block junction in (step/sec)^2
+    uint32_t max_entry_speed_sqr;    // Maximum allowable entry speed based on the minimum of junction limit and
+                                     //   neighboring nominal speeds in (step/sec)^2
+    uint32_t max_junction_speed_sqr; // Junction entry speed limit based on the direction change in (step/sec)^2
+    uint32_t nominal_speed_sqr;      // Axis-limit adjusted nominal speed for this block in (step/sec)^2
+    uint32_t programmed_speed;       // Axis-limit adjusted programmed speed without the feed override in (step/sec)
+    uint32_t acceleration;           // Axis acceleration in (step/sec^2)
+    uint32_t steps_remaining;        // The remaining distance for this block to be executed in (steps)
+  #else
+    // Fields used by the motion planner to manage acceleration
+    float entry_speed_sqr;         // The current planned entry speed at block junction in (deg/min)^2
+    float max_entry_speed_sqr;     // Maximum allowable entry speed based on the minimum of junction limit and 
+                                   //   neighboring nominal speeds with overrides in (deg/min)^2
+    float max_junction_speed_sqr;  // Junction entry speed limit based on direction vectors in (deg/min)^2
+    float nominal_speed_sqr;       // Axis-limit adjusted nominal speed for this block in (deg/min)^2
+    float programmed_rate;         // Axis-limit adjusted programmed rate without the feed override in (deg/min)
+    float acceleration;            // Axis-limit adjusted line acceleration in (deg/min^2)
+    float degrees;                 // The remaining distance for this block to be executed in (deg)
+    // uint8_t max_override;       // Maximum override value based on axis speed limits
+  #endif
 
   #ifdef USE_LINE_NUMBERS
     int32_t line_number;
   #endif
+  #ifdef LASER_MOTION_SYNC
+    uint8_t laser_state;         // Laser state (bit n is laser n) to apply when the block starts
+  #endif
+  #ifdef LDR_READ_QUEUE
+    uint8_t ldr_read_mark;       // LDR read queue head. The reads before it are due when the block starts.
+  #endif
 } plan_block_t;
 
-      
+
+#if defined(COMPACT_PLANNER_BLOCK)
+  // Block values derived from the compact fields. Used by the planner and the segment prep alike.
+  #define plan_block_nominal_speed_sqr(block) ((uint32_t)(block)->nominal_speed*(block)->nominal_speed)
+  #define plan_block_acceleration(block) plan_get_acceleration()
+
+  // Returns the acceleration of all planned blocks in (step/sec^2).
+  uint32_t plan_get_acceleration();
+#elif defined(FIXED_POINT_PLANNER)
+  #define plan_block_nominal_speed_sqr(block) ((block)->nominal_speed_sqr)
+  #define plan_block_acceleration(block) ((block)->acceleration)
+#endif
+
+#ifdef FIXED_POINT_PLANNER
+  // Returns the X axis acceleration setting in (step/sec^2), within the planner limit.
+  uint32_t plan_compute_acceleration();
+#endif
+
 // Initialize and reset the motion plan subsystem
 void plan_reset();
 
@@ -85,7 +152,11 @@ plan_block_t *plan_get_current_block();
 uint8_t plan_next_block_index(uint8_t block_index);
 
 // Called by step segment buffer when computing executing block velocity profile.
-float plan_get_exec_block_exit_speed();
+#ifdef FIXED_POINT_PLANNER
+  uint32_t plan_get_exec_block_exit_speed(); // (step/sec)
+#else
+  float plan_get_exec_block_exit_speed();
+#endif
 
 // Reset the planner position vector (in steps)
 void plan_sync_position();
@@ -93,6 +164,9 @@ void plan_sync_position();
 // Reinitialize plan with a partially completed block
 void plan_cycle_reinitialize();
 
+// Apply the feed override to the planner buffer and replan it
+void plan_update_feed_override();
+
 // Returns the number of active blocks are in the planner buffer.
 uint8_t plan_get_block_buffer_count();
 
@@ -31,17 +31,14 @@
 
 void printString(const char *s)
 {
-  while (*s)
-    serial_write(*s++);
+  serial_write_string(s);
 }
 
 
 // Print a string stored in PGM-memory
 void printPgmString(const char *s)
 {
-  char c;
-  while ((c = pgm_read_byte_near(s++)))
-    serial_write(c);
+  serial_write_pgm_string(s);
 }
 
 
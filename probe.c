@@ -26,6 +26,7 @@
 #include "system.h"
 #include "settings.h"
 #include "probe.h"
+#include "clock.h"
 
 // Inverts the probe pin state depending on user settings.
 uint8_t probe_invert_mask;
@@ -42,6 +43,20 @@ void probe_init()
     PROBE_PORT |= PROBE_MASK;    // Enable internal pull-up resistors. Normal high operation.
     probe_invert_mask = PROBE_MASK; 
   }
+  #ifdef PROBE_PIN_INTERRUPT
+    PCICR |= (1 << PROBE_INT); // Enable Pin Change Interrupt. The pin is enabled while probing.
+  #endif
+}
+
+
+// Starts watching the probe pin for the probing cycle.
+void probe_activate()
+{
+  sys.probe_state = PROBE_ACTIVE;
+  #ifdef PROBE_PIN_INTERRUPT
+    PCIFR = (1 << PROBE_INT); // Clear any pin change before this cycle. Same bit as the enable.
+    PROBE_PCMSK |= PROBE_MASK;
+  #endif
 }
 
 
@@ -49,16 +64,43 @@ void probe_init()
 uint8_t probe_get_state() { return((PROBE_PIN & PROBE_MASK) ^ probe_invert_mask); }
 
 
-// Monitors probe pin state and records the system position when detected. Called by the
-// stepper ISR per ISR tick.
-// NOTE: This function must be extremely efficient as to not bog down the stepper ISR.
-void probe_state_monitor()
-{
-  if (sys.probe_state == PROBE_ACTIVE) { 
-    if (probe_get_state()) {
-      sys.probe_state = PROBE_OFF;
-      memcpy(sys.probe_position, sys.position, sizeof(float)*N_AXIS);
+#ifdef PROBE_PIN_INTERRUPT
+  // Records the system position of a triggered probe. Called by the probe pin interrupt, or by the
+  // stepper ISR and the probing cycle when the trigger left the latch to them.
+  void probe_latch_position()
+  {
+    memcpy(sys.probe_position, sys.position, sizeof(sys.position));
+    sys.probe_state = PROBE_OFF;
+  }
+
+
+  // Probe pin change interrupt. Timestamps the trigger edge and stops the probing motion. The
+  // stepper ISR re-enables interrupts before it updates the position, so the edge may find it
+  // partly written. While the stepper runs, the position is latched at its next tick instead,
+  // before it changes again.
+  ISR(PROBE_INT_vect)
+  {
+    if (sys.probe_state == PROBE_ACTIVE) {
+      if (!probe_get_state()) { return; } // Released edge. Keep watching.
+      sys.probe_time = clock_get_usec();
       bit_true(sys.execute, EXEC_FEED_HOLD);
+      if (TIMSK1 & (1<<OCIE1A)) { sys.probe_state = PROBE_LATCH; }
+      else { probe_latch_position(); }
     }
+    PROBE_PCMSK &= ~PROBE_MASK; // Triggered or not probing. Stop watching.
   }
-}
+#else
+  // Monitors probe pin state and records the system position when detected. Called by the
+  // stepper ISR per ISR tick.
+  // NOTE: This function must be extremely efficient as to not bog down the stepper ISR.
+  void probe_state_monitor()
+  {
+    if (sys.probe_state == PROBE_ACTIVE) { 
+      if (probe_get_state()) {
+        sys.probe_state = PROBE_OFF;
+        memcpy(sys.probe_position, sys.position, sizeof(float)*N_AXIS);
+        bit_true(sys.execute, EXEC_FEED_HOLD);
+      }
+    }
+  }
+#endif
@@ -29,16 +29,25 @@
 // Values that define the probing state machine.  
 #define PROBE_OFF     0 // No probing. (Must be zero.)
 #define PROBE_ACTIVE  1 // Actively watching the input pin.
+#define PROBE_LATCH   2 // Triggered. The stepper ISR latches the position at its next tick.
 
 
 // Probe pin initialization routine.
 void probe_init();
 
+// Starts watching the probe pin for the probing cycle.
+void probe_activate();
+
 // Returns probe pin state.
 uint8_t probe_get_state();
 
+#ifdef PROBE_PIN_INTERRUPT
+// Records the system position of a triggered probe. Called when the probe state is PROBE_LATCH.
+void probe_latch_position();
+#else
 // Monitors probe pin state and records the system position when detected. Called by the
 // stepper ISR per ISR tick.
 void probe_state_monitor();
+#endif
 
 #endif
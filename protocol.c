@@ -33,6 +33,9 @@
 #include "stepper.h"
 #include "motion_control.h"
 #include "report.h"
+#include "packet.h"
+#include "timer.h"
+#include "sync.h"
 
 
 static char line[LINE_BUFFER_SIZE]; // Line to be executed. Zero-terminated.
@@ -59,6 +62,10 @@ static void protocol_execute_line(char *line)
     // Everything else is gcode. Block if in alarm mode.
     report_status_message(STATUS_ALARM_LOCK);
 
+  } else if (sys.jog_rate != 0.0) {
+    // Block during a jog. Its motion does not end until the jog is stopped.
+    report_status_message(STATUS_IDLE_ERROR);
+
   } else {
     // Parse and execute g-code block!
     report_status_message(gc_execute_line(line));
@@ -66,6 +73,27 @@ static void protocol_execute_line(char *line)
 }
 
 
+#ifdef BINARY_PROTOCOL
+// Reads and executes the binary packet following a received start byte. Waits for the remaining
+// packet bytes first, since a data byte may equal SERIAL_NO_DATA and can only be told apart by
+// the buffer count.
+static void protocol_execute_packet()
+{
+  uint8_t data[PACKET_SIZE-1];
+  uint8_t idx;
+  while (serial_get_rx_buffer_count() < (PACKET_SIZE-1)) {
+    protocol_execute_runtime(); // Runtime command check point.
+    if (sys.abort) { return; } // Bail to calling function upon system abort  
+  }
+  for (idx=0; idx<(PACKET_SIZE-1); idx++) { data[idx] = serial_read(); }
+
+  // Packets are g-code commands. Block if in alarm mode.
+  if (sys.state == STATE_ALARM) { report_status_message(STATUS_ALARM_LOCK); }
+  else { report_status_message(packet_execute(data)); }
+}
+#endif
+
+
 /* 
   GRBL PRIMARY LOOP:
 */
@@ -86,6 +114,10 @@ void protocol_main_loop()
     sys.state = STATE_IDLE; // Set system to ready. Clear all state flags.
     system_execute_startup(line); // Execute startup script.
   }
+  #ifdef FAST_BOOT
+    // The startup script responses are done, so none of them mix with the responses to the host.
+    report_feedback_message(MESSAGE_READY);
+  #endif
     
   // ---------------------------------------------------------------------------------  
   // Primary loop! Upon a system abort, this exits back to main() to reset the system. 
@@ -107,6 +139,13 @@ void protocol_main_loop()
     // seperate task to be shared by the g-code parser and Grbl's system commands.
     
     while((c = serial_read()) != SERIAL_NO_DATA) {
+      #ifdef BINARY_PROTOCOL
+        if (c == PACKET_START) { // Binary packet. Independent of any partial line in the buffer.
+          protocol_execute_packet();
+          if (sys.abort) { return; } // Bail to main() program loop to reset system.
+          continue;
+        }
+      #endif
       if ((c == '\n') || (c == '\r')) { // End of line reached
         line[char_counter] = 0; // Set string termination character.
         protocol_execute_line(line); // Line is complete. Execute it!
@@ -183,6 +222,29 @@ void protocol_main_loop()
 // limit switches, or the main program.
 void protocol_execute_runtime()
 {
+  #ifdef DIAGNOSTIC_COUNTERS
+    // Time the main program loop as the interval between runtime checkpoints. Long intervals delay
+    // the segment buffer refill and the realtime commands.
+    uint8_t sreg = SREG;
+    cli();
+    uint16_t tick = diag.tick;
+    SREG = sreg;
+    diag.loop_time = tick - diag.loop_tick;
+    diag.loop_tick = tick;
+    if (diag.loop_time > diag.loop_time_max) { diag.loop_time_max = diag.loop_time; }
+  #endif
+
+  // Push a status report every status report interval, without waiting for a '?' from the host.
+  // Held back while the serial TX buffer is still draining, so the reports never block the main loop.
+  if (settings.status_report_interval) {
+    if (!timer_active(TIMER_STATUS_REPORT)) {
+      timer_start(TIMER_STATUS_REPORT, settings.status_report_interval, settings.status_report_interval, NULL);
+    }
+    if ((serial_get_tx_buffer_count() == 0) && timer_expired(TIMER_STATUS_REPORT)) {
+      bit_true_atomic(sys.execute,EXEC_STATUS_REPORT);
+    }
+  }
+
   uint8_t rt_exec = sys.execute; // Copy to avoid calling volatile multiple times
   if (rt_exec) { // Enter only if any bit flag is true
     
@@ -190,12 +252,15 @@ void protocol_execute_runtime()
     // the source of the error to the user. If critical, Grbl disables by entering an infinite
     // loop until system reset/abort.
     if (rt_exec & (EXEC_ALARM | EXEC_CRIT_EVENT)) {
+      uint8_t homing = (sys.state == STATE_HOMING);
       sys.state = STATE_ALARM; // Set system alarm state
 
       // Critical events. Hard/soft limit events identified by both critical event and alarm exec
-      // flags. Probe fail is identified by the critical event exec flag only.
+      // flags. Probe fail is identified by the critical event exec flag only, and homing fail by
+      // the critical event exec flag raised in the homing state.
       if (rt_exec & EXEC_CRIT_EVENT) {
         if (rt_exec & EXEC_ALARM) { report_alarm_message(ALARM_LIMIT_ERROR); }
+        else if (homing) { report_alarm_message(ALARM_HOMING_FAIL); }
         else { report_alarm_message(ALARM_PROBE_FAIL); }
         report_feedback_message(MESSAGE_CRITICAL_EVENT);
         bit_false_atomic(sys.execute,EXEC_RESET); // Disable any existing reset
@@ -223,6 +288,13 @@ void protocol_execute_runtime()
       return; // Nothing else to do but exit.
     }
     
+    // Apply a new feed override to the planner buffer. Cleared first, so a change received
+    // meanwhile is applied again.
+    if (rt_exec & EXEC_FEED_OVERRIDE) {
+      bit_false_atomic(sys.execute,EXEC_FEED_OVERRIDE);
+      plan_update_feed_override();
+    }
+
     // Execute and serial print status
     if (rt_exec & EXEC_STATUS_REPORT) { 
       report_realtime_status();
@@ -244,6 +316,9 @@ void protocol_execute_runtime()
         
     // Execute a cycle start by starting the stepper interrupt begin executing the blocks in queue.
     if (rt_exec & EXEC_CYCLE_START) { 
+      #ifdef SYNC_BUS
+        sync_disarm(); // A cycle start '~' releases the held motions like the sync edge.
+      #endif
       if (sys.state == STATE_QUEUED) {
         sys.state = STATE_CYCLE;
         st_prep_buffer(); // Initialize step segment buffer before beginning cycle.
@@ -269,10 +344,20 @@ void protocol_execute_runtime()
     }
 
   }
+
+  #ifdef LDR_STREAMING
+    ldr_stream_report(); // Send any latched LDR records the TX buffer has room for.
+  #endif
+  #ifdef LDR_READ_QUEUE
+    ldr_read_report(); // Send any due M50 readings the TX buffer has room for.
+  #endif
   
   // Overrides flag byte (sys.override) and execution should be installed here, since they 
   // are runtime and require a direct and controlled interface to the main stepper program.
 
+  // Keep a continuous rotation jog queued.
+  mc_jog_execute();
+
   // Reload step segment buffer
   if (sys.state & (STATE_CYCLE | STATE_HOLD | STATE_HOMING)) { st_prep_buffer(); }  
   
@@ -304,4 +389,10 @@ void protocol_buffer_synchronize()
 // NOTE: This function is called from the main loop and mc_line() only and executes when one of
 // two conditions exist respectively: There are no more blocks sent (i.e. streaming is finished, 
 // single commands), or the planner buffer is full and ready to go.
-void protocol_auto_cycle_start() { if (sys.auto_start) { bit_true_atomic(sys.execute, EXEC_CYCLE_START); } } 
+void protocol_auto_cycle_start()
+{
+  #ifdef SYNC_BUS
+    if (sys.sync_armed) { return; } // Held for the sync input edge.
+  #endif
+  if (sys.auto_start) { bit_true_atomic(sys.execute, EXEC_CYCLE_START); }
+}
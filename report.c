@@ -39,6 +39,34 @@
 #include "planner.h"
 #include "stepper.h"
 #include "serial.h"
+#include "clock.h"
+#include "packet.h"
+
+
+static uint8_t report_pending_acks; // Executed lines not acknowledged yet by a terse ack.
+
+
+// Terse responses for slow links, such as Bluetooth. An ack is one REPORT_TERSE_ACK byte carrying the
+// count of lines it acknowledges, so it can't be mistaken for the start of another response. Up to
+// settings.ack_lines lines share one ack, but it's never held back once the RX buffer has no more
+// lines to execute, so the host always hears about the end of its batch. An error is 'e' and the
+// status code, after the ack of the lines before it. Empty lines get no ack, but may end the batch.
+static void report_terse_status(uint8_t status_code)
+{
+  if (status_code == STATUS_OK) { report_pending_acks++; }
+  if ((status_code == STATUS_OK) || (status_code == STATUS_NONE)) {
+    if ((report_pending_acks < settings.ack_lines) && serial_get_rx_buffer_count()) { return; }
+  }
+  if (report_pending_acks) {
+    serial_write(REPORT_TERSE_ACK | report_pending_acks);
+    report_pending_acks = 0;
+  }
+  if ((status_code != STATUS_OK) && (status_code != STATUS_NONE)) {
+    serial_write('e');
+    print_uint8_base10(status_code);
+    serial_write('\n');
+  }
+}
 
 
 // Handles the primary confirmation protocol response for streaming interfaces and human-feedback.
@@ -47,13 +75,25 @@
 // operation. Errors events can originate from the g-code parser, settings module, or asynchronously
 // from a critical error, such as a triggered hard limit. Interface should always monitor for these
 // responses.
-// NOTE: In silent mode, all error codes are greater than zero.
-// TODO: Install silent mode to return only numeric values, primarily for GUIs.
+// NOTE: In terse mode, set by $34, only the numeric values are sent. See report_terse_status().
 void report_status_message(uint8_t status_code) 
+{
+  if (settings.terse_responses) { report_terse_status(status_code); }
+  else { report_unsolicited_status(status_code); }
+}
+
+
+void report_unsolicited_status(uint8_t status_code)
 {
   if (status_code != STATUS_NONE) {
     if (status_code == STATUS_OK) {
-      printPgmString(PSTR("ok\r\n"));
+      if (settings.rx_credit_report) {
+        // Free RX buffer bytes, after this line has been read. Lets the host stream lines ahead.
+        printPgmString(PSTR("ok:")); print_uint8_base10(serial_get_rx_buffer_free());
+        printPgmString(PSTR("\r\n"));
+      } else {
+        printPgmString(PSTR("ok\r\n"));
+      }
     } else {
       printPgmString(PSTR("error: "));
       switch(status_code) {          
@@ -79,6 +119,8 @@ void report_status_message(uint8_t status_code)
         printPgmString(PSTR("Homing not enabled")); break;
         case STATUS_OVERFLOW:
         printPgmString(PSTR("Line overflow")); break; 
+        case STATUS_BAD_PACKET:
+        printPgmString(PSTR("Bad packet")); break;
         
         // Common g-code parser errors.
         case STATUS_GCODE_MODAL_GROUP_VIOLATION:
@@ -108,6 +150,8 @@ void report_alarm_message(int8_t alarm_code)
     printPgmString(PSTR("Abort during cycle")); break;
     case ALARM_PROBE_FAIL:
     printPgmString(PSTR("Probe fail")); break;
+    case ALARM_HOMING_FAIL:
+    printPgmString(PSTR("Homing fail")); break;
   }
   printPgmString(PSTR("\r\n"));
   delay_ms(500); // Force delay to ensure message clears serial write buffer.
@@ -133,6 +177,8 @@ void report_feedback_message(uint8_t message_code)
     printPgmString(PSTR("Enabled")); break;
     case MESSAGE_DISABLED:
     printPgmString(PSTR("Disabled")); break; 
+    case MESSAGE_READY:
+    printPgmString(PSTR("Ready")); break;
   }
   printPgmString(PSTR("]\r\n"));
 }
@@ -141,7 +187,12 @@ void report_feedback_message(uint8_t message_code)
 // Welcome message
 void report_init_message()
 {
-  printPgmString(PSTR("\r\nHorus " HORUS_VERSION " ['$' for help]\r\n"));
+  report_pending_acks = 0; // Lost with the reset.
+  if (settings.terse_responses) {
+    printPgmString(PSTR("\r\nHorus " HORUS_VERSION "\r\n"));
+  } else {
+    printPgmString(PSTR("\r\nHorus " HORUS_VERSION " ['$' for help]\r\n"));
+  }
 }
 
 // Grbl help message
@@ -155,7 +206,15 @@ void report_grbl_help() {
                       "$Nx=line (save startup block)\r\n"
                       "$C (check gcode mode)\r\n"
                       "$X (kill alarm lock)\r\n"
-                      "~ (cycle start)\r\n"
+                      "$SXstep Lcount [Ffeed Tlasers Pdwell] (run scan)\r\n"
+                      "$JFrate (jog at rate, $J stops)\r\n"));
+  #ifdef DIAGNOSTIC_COUNTERS
+    printPgmString(PSTR("$D (view and clear diagnostics)\r\n"));
+  #endif
+  #ifdef STEP_TRACE
+    printPgmString(PSTR("$T (dump and clear step trace)\r\n"));
+  #endif
+  printPgmString(PSTR("~ (cycle start)\r\n"
                       "! (feed hold)\r\n"
                       "? (current status)\r\n"
                       "ctrl-x (reset)\r\n"));
@@ -184,13 +243,19 @@ void report_grbl_settings() {
   printPgmString(PSTR(" (auto start, bool)\r\n$20=")); print_uint8_base10(bit_istrue(settings.flags,BITFLAG_SOFT_LIMIT_ENABLE));
   printPgmString(PSTR(" (soft limits, bool)\r\n$21=")); print_uint8_base10(bit_istrue(settings.flags,BITFLAG_HARD_LIMIT_ENABLE));
   printPgmString(PSTR(" (hard limits, bool)\r\n$22=")); print_uint8_base10(bit_istrue(settings.flags,BITFLAG_HOMING_ENABLE));
-  /*printPgmString(PSTR(" (homing cycle, bool)\r\n$23=")); print_uint8_base10(settings.homing_dir_mask);
+  printPgmString(PSTR(" (homing cycle, bool)\r\n$23=")); print_uint8_base10(settings.homing_dir_mask);
   printPgmString(PSTR(" (homing dir invert mask:")); print_uint8_base2(settings.homing_dir_mask);  
-  printPgmString(PSTR(")\r\n$24=")); printFloat_SettingValue(settings.homing_feed_rate);
-  printPgmString(PSTR(" (homing feed, mm/min)\r\n$25=")); printFloat_SettingValue(settings.homing_seek_rate);
-  printPgmString(PSTR(" (homing seek, mm/min)\r\n$26=")); print_uint8_base10(settings.homing_debounce_delay);
-  printPgmString(PSTR(" (homing debounce, msec)\r\n$27=")); printFloat_SettingValue(settings.homing_pulloff);*/
-  printPgmString(PSTR(" (homing pull-off, mm)\r\n"));
+  printPgmString(PSTR(")\r\n$24=")); printFloat_SettingValue(settings.homing_feed_rate/60);
+  printPgmString(PSTR(" (homing feed, deg/sec)\r\n$25=")); printFloat_SettingValue(settings.homing_seek_rate/60);
+  printPgmString(PSTR(" (homing seek, deg/sec)\r\n$26=")); print_uint32_base10(settings.homing_debounce_delay);
+  printPgmString(PSTR(" (homing debounce, msec)\r\n$27=")); printFloat_SettingValue(settings.homing_pulloff);
+  printPgmString(PSTR(" (homing pull-off, deg)\r\n$30=")); print_uint32_base10(settings.trigger_step_interval);
+  printPgmString(PSTR(" (trigger step interval, steps)\r\n$31=")); print_uint32_base10(settings.status_report_interval);
+  printPgmString(PSTR(" (status report interval, msec)\r\n$32=")); print_uint32_base10(settings.baud_rate);
+  printPgmString(PSTR(" (baud rate at power-up, bps)\r\n$33=")); print_uint8_base10(settings.rx_credit_report);
+  printPgmString(PSTR(" (rx credits, bool)\r\n$34=")); print_uint8_base10(settings.terse_responses);
+  printPgmString(PSTR(" (terse responses, bool)\r\n$35=")); print_uint8_base10(settings.ack_lines);
+  printPgmString(PSTR(" (lines per ack, 0-9)\r\n"));
 
   // Print axis settings
   uint8_t idx, set_idx;
@@ -240,6 +305,10 @@ void report_probe_parameters()
     printFloat_CoordValue(print_position[i]);
     if (i < (N_AXIS-1)) { printPgmString(PSTR(",")); }
   }  
+  #ifdef PROBE_PIN_INTERRUPT
+    printPgmString(PSTR(",T:"));
+    print_uint32_base10(sys.probe_time);
+  #endif
   printPgmString(PSTR("]\r\n"));
 }
 
@@ -251,7 +320,7 @@ void report_ngc_parameters()
   uint8_t coord_select, i;
   for (coord_select = 0; coord_select <= SETTING_INDEX_NCOORD; coord_select++) { 
     if (!(settings_read_coord_data(coord_select,coord_data))) { 
-      report_status_message(STATUS_SETTING_READ_FAIL); 
+      report_unsolicited_status(STATUS_SETTING_READ_FAIL); 
       return;
     } 
     printPgmString(PSTR("[G"));
@@ -352,6 +421,51 @@ void report_startup_line(uint8_t n, char *line)
 }
 
 
+// Prints scan sequence sync marker. Sent right after the frame's laser pattern is set, so the
+// interface can capture the frame while the sequencer waits the exposure time.
+void report_scan_marker(uint16_t step, uint8_t frame)
+{
+  printPgmString(PSTR("[S:"));
+  print_uint32_base10(step);
+  printPgmString(PSTR(","));
+  print_uint8_base10(frame);
+  printPgmString(PSTR("]\r\n"));
+}
+
+
+void report_ldr_record(int32_t position, uint16_t value)
+{
+  printPgmString(PSTR("[L:"));
+  printInteger(position);
+  printPgmString(PSTR(","));
+  print_uint32_base10(value);
+  printPgmString(PSTR("]\r\n"));
+}
+
+
+void report_ldr_read(int32_t tag, uint16_t value)
+{
+  printPgmString(PSTR("[R:"));
+  printInteger(tag);
+  printPgmString(PSTR(","));
+  print_uint32_base10(value);
+  printPgmString(PSTR("]\r\n"));
+}
+
+
+#ifdef STEP_TRACE
+// Prints a step trace record. The time is in CPU cycles of the stepper clock.
+void report_step_trace(uint32_t time, int32_t position)
+{
+  printPgmString(PSTR("[T:"));
+  print_uint32_base10(time);
+  printPgmString(PSTR(","));
+  printInteger(position);
+  printPgmString(PSTR("]\r\n"));
+}
+#endif
+
+
 // Prints build info line
 void report_build_info(char *line)
 {
@@ -361,6 +475,51 @@ void report_build_info(char *line)
 }
 
 
+#ifdef DIAGNOSTIC_COUNTERS
+// Prints the interrupt and buffer health counters since the last report and clears them. Interrupt
+// times are in CPU cycles, buffer levels in blocks and bytes, and loop times in microseconds.
+void report_diagnostics()
+{
+  diag_t snapshot;
+  uint8_t sreg = SREG;
+  cli(); // Copy the counters the interrupts update in one piece.
+  memcpy(&snapshot, &diag, sizeof(diag_t));
+  diag.isr_count = 0;
+  diag.isr_entry_max = 0;
+  diag.isr_cycles_max = 0;
+  diag.isr_overrun = 0;
+  diag.underrun = 0;
+  diag.planner_max = 0;
+  diag.rx_max = 0;
+  SREG = sreg;
+
+  printPgmString(PSTR("[ISR:"));
+  print_uint32_base10(snapshot.isr_count);
+  printPgmString(PSTR(",")); print_uint32_base10(snapshot.isr_entry_max);
+  printPgmString(PSTR(",")); print_uint32_base10(snapshot.isr_cycles);
+  printPgmString(PSTR(",")); print_uint32_base10(snapshot.isr_cycles_max);
+  printPgmString(PSTR(",OVR:")); print_uint32_base10(snapshot.isr_overrun);
+  printPgmString(PSTR(",UND:")); print_uint32_base10(snapshot.underrun);
+  printPgmString(PSTR(",PLN:")); print_uint8_base10(snapshot.planner_max);
+  printPgmString(PSTR("/")); print_uint8_base10(BLOCK_BUFFER_SIZE-1);
+  printPgmString(PSTR(",RX:")); print_uint8_base10(snapshot.rx_max);
+  printPgmString(PSTR("/")); print_uint8_base10(RX_BUFFER_SIZE-1);
+  printPgmString(PSTR(",TX:")); print_uint8_base10(snapshot.tx_max);
+  printPgmString(PSTR("/")); print_uint8_base10(TX_BUFFER_SIZE-1);
+  printPgmString(PSTR(",LOOP:")); print_uint32_base10(snapshot.loop_time*DIAG_TICK_USEC);
+  printPgmString(PSTR(",")); print_uint32_base10(snapshot.loop_time_max*DIAG_TICK_USEC);
+  printPgmString(PSTR("]\r\n"));
+
+  // Clear the TX and loop marks after printing, so the next report does not hold this one.
+  diag.tx_max = 0;
+  cli();
+  diag.loop_tick = diag.tick;
+  SREG = sreg;
+  diag.loop_time_max = 0;
+}
+#endif
+
+
  // Prints real-time data. This function grabs a real-time snapshot of the stepper subprogram 
  // and the actual location of the CNC machine. Users may change the following function to their
  // specific needs, but the desired real-time data report must be as short as possible. This is
@@ -374,8 +533,43 @@ void report_realtime_status()
   // for a user to select the desired real-time data.
   uint8_t i;
   int32_t current_position[N_AXIS]; // Copy current state of the system position variable
+  // Sample the position and the clock together, so the host can place the sample in time.
+  uint8_t sreg = SREG;
+  cli();
   memcpy(current_position,sys.position,sizeof(sys.position));
+  uint32_t timestamp = clock_get_usec();
+  SREG = sreg;
   float print_position[N_AXIS];
+
+  // Report a compact binary packet instead, with the fields in the mask bit order. Positions are
+  // the X axis in steps, so the report formats no floats and fits the serial TX buffer at once.
+  // [type][mask][state][MPos int32][WPos int32][Buf uint8][RX uint8][T uint32], little-endian.
+  if (bit_istrue(settings.status_report_mask,BITFLAG_RT_STATUS_BINARY)) {
+    uint8_t data[3+4+4+1+1+4];
+    uint8_t length = 0;
+    data[length++] = PACKET_REPORT_STATUS;
+    data[length++] = settings.status_report_mask;
+    data[length++] = sys.state;
+    if (bit_istrue(settings.status_report_mask,BITFLAG_RT_STATUS_MACHINE_POSITION)) {
+      memcpy(&data[length],&current_position[X_AXIS],sizeof(int32_t)); length += sizeof(int32_t);
+    }
+    if (bit_istrue(settings.status_report_mask,BITFLAG_RT_STATUS_WORK_POSITION)) {
+      int32_t work_position = current_position[X_AXIS] -
+        lround((gc_state.coord_system[X_AXIS]+gc_state.coord_offset[X_AXIS])*settings.steps_per_deg[X_AXIS]);
+      memcpy(&data[length],&work_position,sizeof(int32_t)); length += sizeof(int32_t);
+    }
+    if (bit_istrue(settings.status_report_mask,BITFLAG_RT_STATUS_PLANNER_BUFFER)) {
+      data[length++] = plan_get_block_buffer_count();
+    }
+    if (bit_istrue(settings.status_report_mask,BITFLAG_RT_STATUS_SERIAL_RX)) {
+      data[length++] = serial_get_rx_buffer_count();
+    }
+    if (bit_istrue(settings.status_report_mask,BITFLAG_RT_STATUS_TIMESTAMP)) {
+      memcpy(&data[length],&timestamp,sizeof(uint32_t)); length += sizeof(uint32_t);
+    }
+    packet_write(data,length);
+    return;
+  }
  
   // Report current machine state
   switch (sys.state) {
@@ -413,6 +607,21 @@ void report_realtime_status()
       if (i < (N_AXIS-1)) { printPgmString(PSTR(",")); }
     }
   }
+
+  // Report machine position in steps, as counted by the stepper interrupt
+  if (bit_istrue(settings.status_report_mask,BITFLAG_RT_STATUS_STEP_POSITION)) {
+    printPgmString(PSTR(",SPos:"));
+    for (i=0; i< N_AXIS; i++) {
+      printInteger(current_position[i]);
+      if (i < (N_AXIS-1)) { printPgmString(PSTR(",")); }
+    }
+  }
+
+  // Report the time the position was sampled, in microseconds since power-up
+  if (bit_istrue(settings.status_report_mask,BITFLAG_RT_STATUS_TIMESTAMP)) {
+    printPgmString(PSTR(",T:"));
+    print_uint32_base10(timestamp);
+  }
         
   // Returns the number of active blocks are in the planner buffer.
   if (bit_istrue(settings.status_report_mask,BITFLAG_RT_STATUS_PLANNER_BUFFER)) {
@@ -442,6 +651,12 @@ void report_realtime_status()
     printPgmString(PSTR(",F:")); 
     printFloat_RateValue(st_get_realtime_rate());
   #endif    
+
+  // Report the feed override, while one is applied
+  if (sys.f_override != 100) {
+    printPgmString(PSTR(",Ov:"));
+    print_uint8_base10(sys.f_override);
+  }
   
   printPgmString(PSTR(">\r\n"));
 }
@@ -40,6 +40,7 @@
 #define STATUS_SOFT_LIMIT_ERROR 10
 #define STATUS_OVERFLOW 11
 #define STATUS_NONE 12
+#define STATUS_BAD_PACKET 13
 
 #define STATUS_GCODE_UNSUPPORTED_COMMAND 20
 #define STATUS_GCODE_MODAL_GROUP_VIOLATION 21
@@ -64,6 +65,7 @@
 #define ALARM_LIMIT_ERROR -1
 #define ALARM_ABORT_CYCLE -2
 #define ALARM_PROBE_FAIL -3
+#define ALARM_HOMING_FAIL -4
 
 // Define Grbl feedback message codes.
 #define MESSAGE_CRITICAL_EVENT 1
@@ -71,10 +73,22 @@
 #define MESSAGE_ALARM_UNLOCK 3
 #define MESSAGE_ENABLED 4
 #define MESSAGE_DISABLED 5
+#define MESSAGE_READY 6
+
+// Most lines acknowledged by one terse ack.
+#define REPORT_MAX_ACK_LINES 9
+
+// Terse ack byte, or'ed with the count of lines it acknowledges. No other response starts with a
+// byte over 0x7F, except the binary packets, which start with 0xA5.
+#define REPORT_TERSE_ACK 0x80
 
 // Prints system status messages.
 void report_status_message(uint8_t status_code);
 
+// Prints the status of a line the host didn't send, such as a startup line, or of a failed EEPROM
+// read. Always in full, even in terse mode, and it doesn't count as a terse ack.
+void report_unsolicited_status(uint8_t status_code);
+
 // Prints system alarm messages.
 void report_alarm_message(int8_t alarm_code);
 
@@ -105,7 +119,26 @@ void report_gcode_modes();
 // Prints startup line
 void report_startup_line(uint8_t n, char *line);
 
+// Prints scan sequence sync marker
+void report_scan_marker(uint16_t step, uint8_t frame);
+
+// Prints a streamed LDR record
+void report_ldr_record(int32_t position, uint16_t value);
+
+// Prints a queued M50 reading with its tag.
+void report_ldr_read(int32_t tag, uint16_t value);
+
+#ifdef STEP_TRACE
+  // Prints a step trace record
+  void report_step_trace(uint32_t time, int32_t position);
+#endif
+
 // Prints build info and user info
 void report_build_info(char *line);
 
+#ifdef DIAGNOSTIC_COUNTERS
+  // Prints the interrupt and buffer health counters and clears them
+  void report_diagnostics();
+#endif
+
 #endif
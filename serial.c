@@ -25,10 +25,14 @@
 */
 
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 #include "system.h"
 #include "serial.h"
 #include "motion_control.h"
 #include "protocol.h"
+#include "stepper.h"
+#include "packet.h"
+#include "laser_control.h"
 
 
 uint8_t serial_rx_buffer[RX_BUFFER_SIZE];
@@ -43,6 +47,10 @@ volatile uint8_t serial_tx_buffer_tail = 0;
 #ifdef ENABLE_XONXOFF
   volatile uint8_t flow_ctrl = XON_SENT; // Flow control state variable
 #endif
+
+#ifdef BINARY_PROTOCOL
+  static uint8_t serial_rx_packet_count = 0; // Remaining bytes of the binary packet being received
+#endif
   
 
 // Returns the number of bytes used in the RX serial buffer.
@@ -54,6 +62,13 @@ uint8_t serial_get_rx_buffer_count()
 }
 
 
+// Returns the number of bytes free in the RX serial buffer. One ring buffer slot is always empty.
+uint8_t serial_get_rx_buffer_free()
+{
+  return((RX_BUFFER_SIZE-1) - serial_get_rx_buffer_count());
+}
+
+
 // Returns the number of bytes used in the TX serial buffer.
 // NOTE: Not used except for debugging and ensuring no TX bottlenecks.
 uint8_t serial_get_tx_buffer_count()
@@ -64,18 +79,42 @@ uint8_t serial_get_tx_buffer_count()
 }
 
 
-void serial_init()
+// Returns the UBRR0 divisor value of a baud rate, rounded to the nearest. The baud doubler is used
+// from 57600 baud up, so the divisor is computed with 8 clocks per bit instead of 16.
+static uint16_t serial_get_ubrr(uint32_t baud_rate)
 {
-  // Set baud rate
-  #if BAUD_RATE < 57600
-    uint16_t UBRR0_value = ((F_CPU / (8L * BAUD_RATE)) - 1)/2 ;
+  if (baud_rate < 57600) { return(((F_CPU / (8L * baud_rate)) - 1)/2); }
+  return(((F_CPU / (4L * baud_rate)) - 1)/2);
+}
+
+
+uint8_t serial_check_baud_rate(uint32_t baud_rate)
+{
+  if ((baud_rate < SERIAL_MIN_BAUD_RATE) || (baud_rate > SERIAL_MAX_BAUD_RATE)) { return(false); }
+  uint32_t clocks_per_bit = (baud_rate < 57600) ? 16 : 8;
+  uint32_t actual = F_CPU / (clocks_per_bit*(serial_get_ubrr(baud_rate)+1));
+  uint32_t error = (actual > baud_rate) ? (actual-baud_rate) : (baud_rate-actual);
+  return(error <= baud_rate/SERIAL_BAUD_RATE_TOLERANCE);
+}
+
+
+void serial_set_baud_rate(uint32_t baud_rate)
+{
+  uint16_t UBRR0_value = serial_get_ubrr(baud_rate);
+  if (baud_rate < 57600) {
     UCSR0A &= ~(1 << U2X0); // baud doubler off  - Only needed on Uno XXX
-  #else
-    uint16_t UBRR0_value = ((F_CPU / (4L * BAUD_RATE)) - 1)/2;
+  } else {
     UCSR0A |= (1 << U2X0);  // baud doubler on for high baud rates, i.e. 115200
-  #endif
+  }
   UBRR0H = UBRR0_value >> 8;
   UBRR0L = UBRR0_value;
+}
+
+
+void serial_init()
+{
+  // Set baud rate
+  serial_set_baud_rate(BAUD_RATE);
             
   // enable rx and tx
   UCSR0B |= 1<<RXEN0;
@@ -88,28 +127,81 @@ void serial_init()
 }
 
 
+// Makes the TX serial buffer data up to head available to the transmitter, and starts it.
+static void serial_tx_start(uint8_t head)
+{
+  serial_tx_buffer_head = head;
+
+  #ifdef DIAGNOSTIC_COUNTERS
+    uint8_t tx_count = serial_get_tx_buffer_count();
+    if (tx_count > diag.tx_max) { diag.tx_max = tx_count; }
+  #endif
+
+  // Enable Data Register Empty Interrupt to make sure tx-streaming is running
+  UCSR0B |=  (1 << UDRIE0);
+}
+
+
+// Waits until the TX serial buffer has room for next head. The segment buffer is refilled meanwhile,
+// so a long print cannot starve the stepper mid-motion. The other runtime commands stay pending until
+// the next runtime checkpoint, so no report is interleaved into a partly printed line. Returns false
+// on an abort.
+static uint8_t serial_tx_wait(uint8_t next_head)
+{
+  while (next_head == serial_tx_buffer_tail) {
+    if (sys.execute & EXEC_RESET) { return(false); } // Only check for abort to avoid an endless loop.
+    if (sys.state & (STATE_CYCLE | STATE_HOLD | STATE_HOMING)) { st_prep_buffer(); }
+  }
+  return(true);
+}
+
+
 // Writes one byte to the TX serial buffer. Called by main program.
-// TODO: Check if we can speed this up for writing strings, rather than single bytes.
 void serial_write(uint8_t data) {
   // Calculate next head
   uint8_t next_head = serial_tx_buffer_head + 1;
   if (next_head == TX_BUFFER_SIZE) { next_head = 0; }
 
   // Wait until there is space in the buffer
-  while (next_head == serial_tx_buffer_tail) { 
-    // TODO: Restructure st_prep_buffer() calls to be executed here during a long print.    
-    if (sys.execute & EXEC_RESET) { return; } // Only check for abort to avoid an endless loop.
-  }
+  if (!serial_tx_wait(next_head)) { return; }
 
   // Store data and advance head
   serial_tx_buffer[serial_tx_buffer_head] = data;
-  serial_tx_buffer_head = next_head;
-  
-  // Enable Data Register Empty Interrupt to make sure tx-streaming is running
-  UCSR0B |=  (1 << UDRIE0); 
+  serial_tx_start(next_head);
+}
+
+
+// Writes a zero-terminated string in RAM, or in program memory if pgm is set, to the TX serial
+// buffer. The bytes are copied in runs as long as the free space, with one head update and
+// transmitter start per run. Only the main program writes the head, so no interrupt lock is needed.
+static void serial_write_chars(const char *s, uint8_t pgm)
+{
+  uint8_t head = serial_tx_buffer_head;
+  uint8_t ttail = serial_tx_buffer_tail; // Copy to limit multiple calls to volatile
+  char c;
+  while ((c = (pgm ? pgm_read_byte_near(s) : *s))) {
+    uint8_t next_head = head + 1;
+    if (next_head == TX_BUFFER_SIZE) { next_head = 0; }
+    if (next_head == ttail) {
+      // Send the bytes copied so far, then wait for room for the rest.
+      serial_tx_start(head);
+      if (!serial_tx_wait(next_head)) { return; }
+      ttail = serial_tx_buffer_tail;
+    }
+    serial_tx_buffer[head] = c;
+    head = next_head;
+    s++;
+  }
+  serial_tx_start(head);
 }
 
 
+void serial_write_string(const char *s) { serial_write_chars(s, false); }
+
+
+void serial_write_pgm_string(const char *s) { serial_write_chars(s, true); }
+
+
 // Data Register Empty Interrupt handler
 ISR(SERIAL_UDRE)
 {
@@ -165,10 +257,62 @@ uint8_t serial_read()
 }
 
 
+// Writes one received byte to the RX serial buffer. Called only by the serial receive interrupt.
+static void serial_rx_write(uint8_t data)
+{
+  uint8_t next_head = serial_rx_buffer_head + 1;
+  if (next_head == RX_BUFFER_SIZE) { next_head = 0; }
+
+  // Write data to buffer unless it is full.
+  if (next_head != serial_rx_buffer_tail) {
+    serial_rx_buffer[serial_rx_buffer_head] = data;
+    serial_rx_buffer_head = next_head;    
+
+    #ifdef DIAGNOSTIC_COUNTERS
+      uint8_t rx_count = serial_get_rx_buffer_count();
+      if (rx_count > diag.rx_max) { diag.rx_max = rx_count; }
+    #endif
+    
+    #ifdef ENABLE_XONXOFF
+      if ((serial_get_rx_buffer_count() >= RX_BUFFER_FULL) && flow_ctrl == XON_SENT) {
+        flow_ctrl = SEND_XOFF;
+        UCSR0B |=  (1 << UDRIE0); // Force TX
+      } 
+    #endif
+    
+  }
+  //TODO: else alarm on overflow?
+}
+
+
+// Changes the feed override by delta percent within its limits, and flags the main program to
+// apply it. Called only by the serial receive interrupt.
+static void serial_feed_override(int16_t delta)
+{
+  int16_t f_override = sys.f_override+delta;
+  if (f_override < FEED_OVERRIDE_MIN) { f_override = FEED_OVERRIDE_MIN; }
+  else if (f_override > FEED_OVERRIDE_MAX) { f_override = FEED_OVERRIDE_MAX; }
+  if (f_override != sys.f_override) {
+    sys.f_override = f_override;
+    bit_true_atomic(sys.execute, EXEC_FEED_OVERRIDE);
+  }
+}
+
+
 ISR(SERIAL_RX)
 {
   uint8_t data = UDR0;
-  uint8_t next_head;
+
+  #ifdef BINARY_PROTOCOL
+    // Binary packet bytes are buffered as they are, so a payload byte that happens to match a 
+    // runtime command character is not picked off.
+    if (serial_rx_packet_count) {
+      serial_rx_packet_count--;
+      serial_rx_write(data);
+      return;
+    }
+    if (data == PACKET_START) { serial_rx_packet_count = PACKET_SIZE-1; }
+  #endif
   
   // Pick off runtime command characters directly from the serial stream. These characters are
   // not passed into the buffer, but these set system state flag bits for runtime execution.
@@ -177,24 +321,15 @@ ISR(SERIAL_RX)
     case CMD_CYCLE_START:   bit_true_atomic(sys.execute, EXEC_CYCLE_START); break; // Set as true
     case CMD_FEED_HOLD:     bit_true_atomic(sys.execute, EXEC_FEED_HOLD); break; // Set as true
     case CMD_RESET:         mc_reset(); break; // Call motion control reset routine.
-    default: // Write character to buffer    
-      next_head = serial_rx_buffer_head + 1;
-      if (next_head == RX_BUFFER_SIZE) { next_head = 0; }
-    
-      // Write data to buffer unless it is full.
-      if (next_head != serial_rx_buffer_tail) {
-        serial_rx_buffer[serial_rx_buffer_head] = data;
-        serial_rx_buffer_head = next_head;    
-        
-        #ifdef ENABLE_XONXOFF
-          if ((serial_get_rx_buffer_count() >= RX_BUFFER_FULL) && flow_ctrl == XON_SENT) {
-            flow_ctrl = SEND_XOFF;
-            UCSR0B |=  (1 << UDRIE0); // Force TX
-          } 
-        #endif
-        
-      }
-      //TODO: else alarm on overflow?
+    case CMD_FEED_OVR_RESET: serial_feed_override(100-sys.f_override); break;
+    case CMD_FEED_OVR_COARSE_PLUS: serial_feed_override(FEED_OVERRIDE_COARSE_INCREMENT); break;
+    case CMD_FEED_OVR_COARSE_MINUS: serial_feed_override(-FEED_OVERRIDE_COARSE_INCREMENT); break;
+    case CMD_FEED_OVR_FINE_PLUS: serial_feed_override(FEED_OVERRIDE_FINE_INCREMENT); break;
+    case CMD_FEED_OVR_FINE_MINUS: serial_feed_override(-FEED_OVERRIDE_FINE_INCREMENT); break;
+    case CMD_LASER_ON: case CMD_LASER_ON+1: case CMD_LASER_ON+2: case CMD_LASER_ON+3:
+    case CMD_LASER_OFF: case CMD_LASER_OFF+1: case CMD_LASER_OFF+2: case CMD_LASER_OFF+3:
+      laser_realtime(data); break;
+    default: serial_rx_write(data); // Write character to buffer    
   }
 }
 
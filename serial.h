@@ -34,9 +34,18 @@
 #ifndef TX_BUFFER_SIZE
   #define TX_BUFFER_SIZE 64
 #endif
+#if (RX_BUFFER_SIZE > 255) || (TX_BUFFER_SIZE > 255)
+  #error "Serial buffers are indexed by a byte. The size must be 255 or less."
+#endif
 
 #define SERIAL_NO_DATA 0xff
 
+// Baud rates accepted by the $32 setting. The rate error of the UBRR divisor may be up to
+// 1/SERIAL_BAUD_RATE_TOLERANCE of the rate. 115200 is 2.1% off at 16MHz.
+#define SERIAL_MIN_BAUD_RATE 2400
+#define SERIAL_MAX_BAUD_RATE 1000000
+#define SERIAL_BAUD_RATE_TOLERANCE 40 // 2.5%
+
 #ifdef ENABLE_XONXOFF
   #define RX_BUFFER_FULL 96 // XOFF high watermark
   #define RX_BUFFER_LOW 64 // XON low watermark
@@ -50,9 +59,22 @@
 
 void serial_init();
 
+// Sets the serial baud rate. Only safe while the TX serial buffer is not sending.
+void serial_set_baud_rate(uint32_t baud_rate);
+
+// Returns true if the baud rate is within the UART range and close enough to an exact divisor
+// of the CPU clock. The 250000, 500000 and 1000000 rates are exact at 16MHz.
+uint8_t serial_check_baud_rate(uint32_t baud_rate);
+
 // Writes one byte to the TX serial buffer. Called by main program.
 void serial_write(uint8_t data);
 
+// Writes a zero-terminated string to the TX serial buffer. Called by main program.
+void serial_write_string(const char *s);
+
+// Writes a zero-terminated string stored in program memory to the TX serial buffer.
+void serial_write_pgm_string(const char *s);
+
 // Fetches the first byte in the serial read buffer. Called by main program.
 uint8_t serial_read();
 
@@ -62,6 +84,9 @@ void serial_reset_read_buffer();
 // Returns the number of bytes used in the RX serial buffer.
 uint8_t serial_get_rx_buffer_count();
 
+// Returns the number of bytes free in the RX serial buffer.
+uint8_t serial_get_rx_buffer_free();
+
 // Returns the number of bytes used in the TX serial buffer.
 // NOTE: Not used except for debugging and ensuring no TX bottlenecks.
 uint8_t serial_get_tx_buffer_count();
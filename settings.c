@@ -30,6 +30,8 @@
 #include "protocol.h"
 #include "report.h"
 #include "stepper.h"
+#include "serial.h"
+#include "timer.h"
 
 settings_t settings;
 
@@ -79,6 +81,12 @@ void settings_restore_global_settings() {
   settings.homing_seek_rate = DEFAULT_HOMING_SEEK_RATE;
   settings.homing_debounce_delay = DEFAULT_HOMING_DEBOUNCE_DELAY;
   settings.homing_pulloff = DEFAULT_HOMING_PULLOFF;
+  settings.trigger_step_interval = DEFAULT_TRIGGER_STEP_INTERVAL;
+  settings.status_report_interval = DEFAULT_STATUS_REPORT_INTERVAL;
+  settings.baud_rate = DEFAULT_BAUD_RATE;
+  settings.rx_credit_report = DEFAULT_RX_CREDIT_REPORT;
+  settings.terse_responses = DEFAULT_TERSE_RESPONSES;
+  settings.ack_lines = DEFAULT_ACK_LINES;
 
   settings.flags = 0;
   if (DEFAULT_REPORT_INCHES) { settings.flags |= BITFLAG_REPORT_INCHES; }
@@ -204,6 +212,9 @@ uint8_t settings_store_global_setting(uint8_t parameter, float value) {
           case 2: settings.acceleration[parameter] = value*60*60; break; // Convert to deg/min^2 for grbl internal use.
           case 3: settings.max_travel[parameter] = -value; break;  // Store as negative for grbl internal use.
         }
+        #ifdef RAMP_TABLE
+          if ((set_idx == 0) || (set_idx == 2)) { st_update_ramp_table(); }
+        #endif
         break; // Exit while-loop after setting has been configured and proceed to the EEPROM write call.
       } else {
         set_idx++;
@@ -240,7 +251,7 @@ uint8_t settings_store_global_setting(uint8_t parameter, float value) {
         if (int_value) { settings.flags |= BITFLAG_INVERT_PROBE_PIN; }
         else { settings.flags &= ~BITFLAG_INVERT_PROBE_PIN; }
         break;
-      case 10: settings.status_report_mask = int_value;
+      case 10: settings.status_report_mask = int_value; break;
       case 11: settings.junction_deviation = value; break;
       case 12: settings.arc_tolerance = value; break;
       case 13:
@@ -270,10 +281,26 @@ uint8_t settings_store_global_setting(uint8_t parameter, float value) {
         }
         break;
       case 23: settings.homing_dir_mask = int_value; break;
-      case 24: settings.homing_feed_rate = value; break;
-      case 25: settings.homing_seek_rate = value; break;
+      case 24: settings.homing_feed_rate = value*60; break; // Convert to deg/min for grbl internal use.
+      case 25: settings.homing_seek_rate = value*60; break; // Convert to deg/min for grbl internal use.
       case 26: settings.homing_debounce_delay = int_value; break;
       case 27: settings.homing_pulloff = value; break;
+      case 30: 
+        if (value > 0xFFFF) { return(STATUS_INVALID_STATEMENT); }
+        settings.trigger_step_interval = trunc(value); break;
+      case 31:
+        if (value > 0xFFFF) { return(STATUS_INVALID_STATEMENT); }
+        settings.status_report_interval = trunc(value);
+        timer_stop(TIMER_STATUS_REPORT); // Restarted with the new interval.
+        break;
+      case 32:
+        if ((value > SERIAL_MAX_BAUD_RATE) || !serial_check_baud_rate(trunc(value))) { return(STATUS_INVALID_STATEMENT); }
+        settings.baud_rate = trunc(value); break;
+      case 33: settings.rx_credit_report = (int_value != 0); break;
+      case 34: settings.terse_responses = (int_value != 0); break;
+      case 35:
+        if (int_value > REPORT_MAX_ACK_LINES) { return(STATUS_INVALID_STATEMENT); }
+        settings.ack_lines = int_value; break;
       default: 
         return(STATUS_INVALID_STATEMENT);
     }
@@ -286,7 +313,7 @@ uint8_t settings_store_global_setting(uint8_t parameter, float value) {
 // Initialize the config subsystem
 void settings_init() {
   if(!read_global_settings()) {
-    report_status_message(STATUS_SETTING_READ_FAIL);
+    report_unsolicited_status(STATUS_SETTING_READ_FAIL);
 
     settings_restore_global_settings();
     
@@ -298,14 +325,17 @@ void settings_init() {
     report_grbl_settings();
   }
 
-  // Check all parameter data into a dummy variable. If error, reset to zero, otherwise do nothing.
-  float coord_data[N_AXIS];
-  uint8_t i;
-  for (i=0; i<=SETTING_INDEX_NCOORD; i++) {
-    if (!settings_read_coord_data(i, coord_data)) {
-      report_status_message(STATUS_SETTING_READ_FAIL);
+  #ifndef FAST_BOOT
+    // Check all parameter data into a dummy variable. If error, reset to zero, otherwise do nothing.
+    // NOTE: With FAST_BOOT, settings_read_coord_data() does the same when the data is first read.
+    float coord_data[N_AXIS];
+    uint8_t i;
+    for (i=0; i<=SETTING_INDEX_NCOORD; i++) {
+      if (!settings_read_coord_data(i, coord_data)) {
+        report_unsolicited_status(STATUS_SETTING_READ_FAIL);
+      }
     }
-  }
+  #endif
   // NOTE: Startup lines are checked and executed by protocol_main_loop at the end of initialization.
   // TODO: Build info should be checked here, but will wait until v1.0 to address this. Ok for now.
 }
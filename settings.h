@@ -32,7 +32,7 @@
 
 // Version of the EEPROM data. Will be used to migrate existing data from older versions of Horus
 // when firmware is upgraded. Always stored in byte 0 of eeprom
-#define SETTINGS_VERSION 1  // NOTE: Check settings_reset() when moving to next version.
+#define SETTINGS_VERSION 6  // NOTE: Check settings_reset() when moving to next version.
 
 // Define bit flag masks for the boolean settings in settings.flag.
 #define BITFLAG_REPORT_INCHES      bit(0)
@@ -49,6 +49,9 @@
 #define BITFLAG_RT_STATUS_WORK_POSITION     bit(1)
 #define BITFLAG_RT_STATUS_PLANNER_BUFFER    bit(2)
 #define BITFLAG_RT_STATUS_SERIAL_RX         bit(3)
+#define BITFLAG_RT_STATUS_STEP_POSITION     bit(4)
+#define BITFLAG_RT_STATUS_TIMESTAMP         bit(5)
+#define BITFLAG_RT_STATUS_BINARY            bit(6) // Compact binary packet instead of text.
 
 // Define EEPROM memory address location values for Horus settings and parameters
 // NOTE: The Atmega328p has 1KB EEPROM. The upper half is reserved for parameters and
@@ -96,6 +99,13 @@ typedef struct {
   float homing_seek_rate;
   uint16_t homing_debounce_delay;
   float homing_pulloff;
+
+  uint16_t trigger_step_interval; // Steps between camera triggers. Zero triggers once per block.
+  uint16_t status_report_interval; // Msec between pushed status reports. Zero reports on '?' only.
+  uint32_t baud_rate; // Serial baud rate set at power-up.
+  uint8_t rx_credit_report; // Reports the free serial RX buffer bytes with each 'ok'.
+  uint8_t terse_responses; // Single character acks and numeric error codes, for slow links.
+  uint8_t ack_lines; // Lines acknowledged by one terse ack, at most. Zero acks every line.
 } settings_t;
 extern settings_t settings;
 
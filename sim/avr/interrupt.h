@@ -0,0 +1,32 @@
+/*
+  avr/interrupt.h - mocked interrupt control for the host simulator
+  Part of Horus Firmware
+
+  Copyright (c) 2014-2015 Mundo Reader S.L.
+
+  Horus Firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Horus Firmware is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Horus Firmware.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef sim_avr_interrupt_h
+#define sim_avr_interrupt_h
+
+#include "avr/io.h"
+
+// Interrupt handlers become plain functions that the simulator calls on timer/peripheral events.
+#define ISR(vector, ...) void vector(void); void vector(void)
+
+#define cli() (SREG &= ~(1<<SREG_I))
+#define sei() (SREG |= (1<<SREG_I))
+
+#endif
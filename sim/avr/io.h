@@ -0,0 +1,197 @@
+/*
+  avr/io.h - mocked ATmega328P register layer for the host simulator
+  Part of Horus Firmware
+
+  Copyright (c) 2014-2015 Mundo Reader S.L.
+
+  Horus Firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Horus Firmware is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Horus Firmware.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef sim_avr_io_h
+#define sim_avr_io_h
+
+#include <stdint.h>
+
+#define __AVR_ATmega328P__
+
+// General purpose I/O ports.
+extern volatile uint8_t DDRB, PORTB, PINB;
+extern volatile uint8_t DDRC, PORTC, PINC;
+extern volatile uint8_t DDRD, PORTD, PIND;
+
+// Status register. Only the global interrupt flag is modelled.
+extern volatile uint8_t SREG;
+#define SREG_I 7
+
+// Timer/Counter0
+extern volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B, TIMSK0, TIFR0;
+#define WGM00 0
+#define WGM01 1
+#define COM0B0 4
+#define COM0B1 5
+#define COM0A0 6
+#define COM0A1 7
+#define CS00 0
+#define CS01 1
+#define CS02 2
+#define WGM02 3
+#define TOIE0 0
+#define OCIE0A 1
+#define OCIE0B 2
+#define TOV0 0
+#define OCF0A 1
+#define OCF0B 2
+
+// Timer/Counter1
+// The compare register is loaded by the stepper interrupt once per segment, so accesses go through
+// the simulator to time the segments. TCNT1 stays zero, as interrupts run in no simulated time.
+extern volatile uint8_t TCCR1A, TCCR1B, TCCR1C, TIMSK1, TIFR1;
+extern volatile uint16_t TCNT1, OCR1B, ICR1;
+extern volatile uint16_t *sim_timer1_reg_ocr1a(void);
+#define OCR1A (*sim_timer1_reg_ocr1a())
+#define WGM10 0
+#define WGM11 1
+#define COM1B0 4
+#define COM1B1 5
+#define COM1A0 6
+#define COM1A1 7
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define WGM12 3
+#define WGM13 4
+#define ICES1 6
+#define ICNC1 7
+#define TOIE1 0
+#define OCIE1A 1
+#define OCIE1B 2
+#define ICIE1 5
+#define TOV1 0
+#define OCF1A 1
+#define OCF1B 2
+#define ICF1 5
+
+// Timer/Counter2. The count is read through the simulator, so it follows simulated time.
+extern volatile uint8_t TCCR2A, TCCR2B, OCR2A, OCR2B, TIMSK2, TIFR2, ASSR;
+extern volatile uint8_t *sim_timer2_reg_tcnt2(void);
+#define TCNT2 (*sim_timer2_reg_tcnt2())
+#define WGM20 0
+#define WGM21 1
+#define COM2B0 4
+#define COM2B1 5
+#define COM2A0 6
+#define COM2A1 7
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define WGM22 3
+#define TOIE2 0
+#define OCIE2A 1
+#define OCIE2B 2
+#define TOV2 0
+#define OCF2A 1
+#define OCF2B 2
+
+// General timer control
+extern volatile uint8_t GTCCR;
+#define PSRSYNC 0
+#define PSRASY 1
+#define TSM 7
+
+// USART0
+extern volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UBRR0H, UBRR0L, UDR0;
+extern volatile uint16_t UBRR0;
+#define MPCM0 0
+#define U2X0 1
+#define UPE0 2
+#define DOR0 3
+#define FE0 4
+#define UDRE0 5
+#define TXC0 6
+#define RXC0 7
+#define TXB80 0
+#define RXB80 1
+#define UCSZ02 2
+#define TXEN0 3
+#define RXEN0 4
+#define UDRIE0 5
+#define TXCIE0 6
+#define RXCIE0 7
+#define UCSZ00 1
+#define UCSZ01 2
+
+// Analog to digital converter. Accesses go through the simulator so polled conversions complete.
+extern volatile uint8_t *sim_adc_reg_adcsra(void);
+#define ADCSRA (*sim_adc_reg_adcsra())
+extern volatile uint8_t ADMUX, ADCSRB, DIDR0;
+extern volatile uint16_t ADCW;
+#define ADC ADCW
+#define ADCL (*(volatile uint8_t *)&ADCW)
+#define ADCH (*((volatile uint8_t *)&ADCW + 1))
+#define MUX0 0
+#define MUX1 1
+#define MUX2 2
+#define MUX3 3
+#define ADLAR 5
+#define REFS0 6
+#define REFS1 7
+#define ADPS0 0
+#define ADPS1 1
+#define ADPS2 2
+#define ADIE 3
+#define ADIF 4
+#define ADATE 5
+#define ADSC 6
+#define ADEN 7
+#define ADTS0 0
+#define ADTS1 1
+#define ADTS2 2
+
+// EEPROM. Accesses go through the simulator so reads and writes take effect.
+extern volatile uint8_t *sim_ee_reg_eecr(void);
+extern volatile uint8_t *sim_ee_reg_eedr(void);
+#define EECR (*sim_ee_reg_eecr())
+#define EEDR (*sim_ee_reg_eedr())
+extern volatile uint16_t EEAR;
+#define EERE 0
+#define EEPE 1
+#define EEMPE 2
+#define EERIE 3
+#define E2END 1023
+
+// External and pin change interrupts
+extern volatile uint8_t EICRA, EIMSK, EIFR, PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2;
+#define ISC00 0
+#define ISC01 1
+#define ISC10 2
+#define ISC11 3
+#define INT0 0
+#define INT1 1
+#define PCIE0 0
+#define PCIE1 1
+#define PCIE2 2
+#define PCIF0 0
+#define PCIF1 1
+#define PCIF2 2
+
+// Miscellaneous
+extern volatile uint8_t MCUSR, WDTCSR, SPMCSR, SMCR, PRR;
+#define SELFPRGEN 0
+#define SPMEN 0
+
+// avr-libc helpers the firmware relies on.
+#define _BV(bit) (1 << (bit))
+char *itoa(int value, char *string, int radix);
+
+#endif
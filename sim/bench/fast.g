@@ -0,0 +1,7 @@
+$100=200
+$120=2000
+M17
+G1 X720 F180
+G1 X0 F180
+G1 X0.5 F10
+G1 X-0.5
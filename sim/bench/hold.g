@@ -0,0 +1,7 @@
+M17
+;at 1500 !
+;at 1505 ?
+;at 2500 ?
+;at 3000 ~
+;at 3500 ?
+G1 X360 F100
@@ -0,0 +1,6 @@
+M17
+;index 100 3
+$22=1
+$H
+G1 X90 F60
+$H
@@ -0,0 +1,8 @@
+M17
+G1 X90 F100
+G1 X180
+G1 X0 F200
+M71 T1
+G1 X10
+M70 T1
+M50 T1
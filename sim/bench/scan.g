@@ -0,0 +1,2 @@
+M17
+$SX0.45L800F12T012
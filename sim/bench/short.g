@@ -0,0 +1,362 @@
+M17
+G1 X0 F200
+G1 X0.50
+G1 X1.00
+G1 X1.50
+G1 X2.00
+G1 X2.50
+G1 X3.00
+G1 X3.50
+G1 X4.00
+G1 X4.50
+G1 X5.00
+G1 X5.50
+G1 X6.00
+G1 X6.50
+G1 X7.00
+G1 X7.50
+G1 X8.00
+G1 X8.50
+G1 X9.00
+G1 X9.50
+G1 X10.00
+G1 X10.50
+G1 X11.00
+G1 X11.50
+G1 X12.00
+G1 X12.50
+G1 X13.00
+G1 X13.50
+G1 X14.00
+G1 X14.50
+G1 X15.00
+G1 X15.50
+G1 X16.00
+G1 X16.50
+G1 X17.00
+G1 X17.50
+G1 X18.00
+G1 X18.50
+G1 X19.00
+G1 X19.50
+G1 X20.00
+G1 X20.50
+G1 X21.00
+G1 X21.50
+G1 X22.00
+G1 X22.50
+G1 X23.00
+G1 X23.50
+G1 X24.00
+G1 X24.50
+G1 X25.00
+G1 X25.50
+G1 X26.00
+G1 X26.50
+G1 X27.00
+G1 X27.50
+G1 X28.00
+G1 X28.50
+G1 X29.00
+G1 X29.50
+G1 X30.00
+G1 X30.50
+G1 X31.00
+G1 X31.50
+G1 X32.00
+G1 X32.50
+G1 X33.00
+G1 X33.50
+G1 X34.00
+G1 X34.50
+G1 X35.00
+G1 X35.50
+G1 X36.00
+G1 X36.50
+G1 X37.00
+G1 X37.50
+G1 X38.00
+G1 X38.50
+G1 X39.00
+G1 X39.50
+G1 X40.00
+G1 X40.50
+G1 X41.00
+G1 X41.50
+G1 X42.00
+G1 X42.50
+G1 X43.00
+G1 X43.50
+G1 X44.00
+G1 X44.50
+G1 X45.00
+G1 X45.50
+G1 X46.00
+G1 X46.50
+G1 X47.00
+G1 X47.50
+G1 X48.00
+G1 X48.50
+G1 X49.00
+G1 X49.50
+G1 X50.00
+G1 X50.50
+G1 X51.00
+G1 X51.50
+G1 X52.00
+G1 X52.50
+G1 X53.00
+G1 X53.50
+G1 X54.00
+G1 X54.50
+G1 X55.00
+G1 X55.50
+G1 X56.00
+G1 X56.50
+G1 X57.00
+G1 X57.50
+G1 X58.00
+G1 X58.50
+G1 X59.00
+G1 X59.50
+G1 X60.00
+G1 X60.50
+G1 X61.00
+G1 X61.50
+G1 X62.00
+G1 X62.50
+G1 X63.00
+G1 X63.50
+G1 X64.00
+G1 X64.50
+G1 X65.00
+G1 X65.50
+G1 X66.00
+G1 X66.50
+G1 X67.00
+G1 X67.50
+G1 X68.00
+G1 X68.50
+G1 X69.00
+G1 X69.50
+G1 X70.00
+G1 X70.50
+G1 X71.00
+G1 X71.50
+G1 X72.00
+G1 X72.50
+G1 X73.00
+G1 X73.50
+G1 X74.00
+G1 X74.50
+G1 X75.00
+G1 X75.50
+G1 X76.00
+G1 X76.50
+G1 X77.00
+G1 X77.50
+G1 X78.00
+G1 X78.50
+G1 X79.00
+G1 X79.50
+G1 X80.00
+G1 X80.50
+G1 X81.00
+G1 X81.50
+G1 X82.00
+G1 X82.50
+G1 X83.00
+G1 X83.50
+G1 X84.00
+G1 X84.50
+G1 X85.00
+G1 X85.50
+G1 X86.00
+G1 X86.50
+G1 X87.00
+G1 X87.50
+G1 X88.00
+G1 X88.50
+G1 X89.00
+G1 X89.50
+G1 X90.00
+G1 X90.50
+G1 X91.00
+G1 X91.50
+G1 X92.00
+G1 X92.50
+G1 X93.00
+G1 X93.50
+G1 X94.00
+G1 X94.50
+G1 X95.00
+G1 X95.50
+G1 X96.00
+G1 X96.50
+G1 X97.00
+G1 X97.50
+G1 X98.00
+G1 X98.50
+G1 X99.00
+G1 X99.50
+G1 X100.00
+G1 X100.50
+G1 X101.00
+G1 X101.50
+G1 X102.00
+G1 X102.50
+G1 X103.00
+G1 X103.50
+G1 X104.00
+G1 X104.50
+G1 X105.00
+G1 X105.50
+G1 X106.00
+G1 X106.50
+G1 X107.00
+G1 X107.50
+G1 X108.00
+G1 X108.50
+G1 X109.00
+G1 X109.50
+G1 X110.00
+G1 X110.50
+G1 X111.00
+G1 X111.50
+G1 X112.00
+G1 X112.50
+G1 X113.00
+G1 X113.50
+G1 X114.00
+G1 X114.50
+G1 X115.00
+G1 X115.50
+G1 X116.00
+G1 X116.50
+G1 X117.00
+G1 X117.50
+G1 X118.00
+G1 X118.50
+G1 X119.00
+G1 X119.50
+G1 X120.00
+G1 X120.50
+G1 X121.00
+G1 X121.50
+G1 X122.00
+G1 X122.50
+G1 X123.00
+G1 X123.50
+G1 X124.00
+G1 X124.50
+G1 X125.00
+G1 X125.50
+G1 X126.00
+G1 X126.50
+G1 X127.00
+G1 X127.50
+G1 X128.00
+G1 X128.50
+G1 X129.00
+G1 X129.50
+G1 X130.00
+G1 X130.50
+G1 X131.00
+G1 X131.50
+G1 X132.00
+G1 X132.50
+G1 X133.00
+G1 X133.50
+G1 X134.00
+G1 X134.50
+G1 X135.00
+G1 X135.50
+G1 X136.00
+G1 X136.50
+G1 X137.00
+G1 X137.50
+G1 X138.00
+G1 X138.50
+G1 X139.00
+G1 X139.50
+G1 X140.00
+G1 X140.50
+G1 X141.00
+G1 X141.50
+G1 X142.00
+G1 X142.50
+G1 X143.00
+G1 X143.50
+G1 X144.00
+G1 X144.50
+G1 X145.00
+G1 X145.50
+G1 X146.00
+G1 X146.50
+G1 X147.00
+G1 X147.50
+G1 X148.00
+G1 X148.50
+G1 X149.00
+G1 X149.50
+G1 X150.00
+G1 X150.50
+G1 X151.00
+G1 X151.50
+G1 X152.00
+G1 X152.50
+G1 X153.00
+G1 X153.50
+G1 X154.00
+G1 X154.50
+G1 X155.00
+G1 X155.50
+G1 X156.00
+G1 X156.50
+G1 X157.00
+G1 X157.50
+G1 X158.00
+G1 X158.50
+G1 X159.00
+G1 X159.50
+G1 X160.00
+G1 X160.50
+G1 X161.00
+G1 X161.50
+G1 X162.00
+G1 X162.50
+G1 X163.00
+G1 X163.50
+G1 X164.00
+G1 X164.50
+G1 X165.00
+G1 X165.50
+G1 X166.00
+G1 X166.50
+G1 X167.00
+G1 X167.50
+G1 X168.00
+G1 X168.50
+G1 X169.00
+G1 X169.50
+G1 X170.00
+G1 X170.50
+G1 X171.00
+G1 X171.50
+G1 X172.00
+G1 X172.50
+G1 X173.00
+G1 X173.50
+G1 X174.00
+G1 X174.50
+G1 X175.00
+G1 X175.50
+G1 X176.00
+G1 X176.50
+G1 X177.00
+G1 X177.50
+G1 X178.00
+G1 X178.50
+G1 X179.00
+G1 X179.50
+G1 X180.00
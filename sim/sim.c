@@ -0,0 +1,781 @@
+/*
+  sim.c - host simulator: mocked AVR peripherals, simulated time and benchmark reporting
+  Part of Horus Firmware
+
+  Copyright (c) 2014-2015 Mundo Reader S.L.
+
+  Horus Firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Horus Firmware is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Horus Firmware.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  The firmware is compiled for the host against the mocked registers in sim/avr. Interrupt handlers
+  are called as the simulated timers, ADC and serial port fall due, and simulated time advances
+  whenever the main program polls for serial data or refills the segment buffer. G-code is replayed
+  from a file one line at a time, each once the previous one is consumed. Lines starting with ';'
+  are simulator directives:
+    ;wait <ms>        Holds back the following lines for ms of simulated time.
+    ;at <ms> <char>   Sends a realtime command character ms of simulated time from now.
+    ;index <deg> <w>  Places an index sensor on the probe pin, triggered within w degrees from deg on
+                      every revolution of the X axis.
+    ;sync <ms>        Pulls the sync input low for 1 ms, ms of simulated time from now (SYNC_BUS).
+  Step and segment timing are measured in simulated time. The g-code parser, planner and segment
+  preparation are timed on the host, as throughput figures to compare builds with.
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <time.h>
+#include "system.h"
+#include "serial.h"
+#include "planner.h"
+#include "stepper.h"
+#include "settings.h"
+#include "packet.h"
+#include "timer.h"
+#include "laser_control.h"
+
+// Register storage for the mocked AVR layer.
+volatile uint8_t DDRB, PORTB, PINB, DDRC, PORTC, PINC, DDRD, PORTD, PIND;
+volatile uint8_t SREG;
+volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B, TIMSK0, TIFR0;
+volatile uint8_t TCCR1A, TCCR1B, TCCR1C, TIMSK1, TIFR1;
+volatile uint16_t TCNT1, OCR1B, ICR1;
+volatile uint8_t TCCR2A, TCCR2B, OCR2A, OCR2B, TIMSK2, TIFR2, ASSR;
+volatile uint8_t GTCCR;
+volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UBRR0H, UBRR0L, UDR0;
+volatile uint16_t UBRR0;
+volatile uint8_t ADMUX, ADCSRB, DIDR0;
+volatile uint16_t ADCW;
+volatile uint16_t EEAR;
+volatile uint8_t EICRA, EIMSK, EIFR, PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2;
+volatile uint8_t MCUSR, WDTCSR, SPMCSR, SMCR, PRR;
+
+int __heap_start, *__brkval;
+
+// Interrupt handlers defined by the firmware.
+void TIMER1_COMPA_vect(void);
+void TIMER0_OVF_vect(void);
+void SERIAL_RX(void);
+void SERIAL_UDRE(void);
+// Optional handlers. Weak so the simulator links whichever peripherals the build uses.
+void TIMER2_COMPA_vect(void) __attribute__((weak));
+void TIMER2_COMPB_vect(void) __attribute__((weak));
+void ADC_vect(void) __attribute__((weak));
+void EE_READY_vect(void) __attribute__((weak));
+void PROBE_INT_vect(void) __attribute__((weak));
+#ifdef SYNC_BUS
+  void SYNC_INT_vect(void);
+#endif
+
+int firmware_main(void);
+
+// Wrapped firmware entry points (see -Wl,--wrap in the Makefile).
+void __real_st_prep_buffer(void);
+uint8_t __real_serial_read(void);
+void __real_serial_write(uint8_t data);
+void __real_serial_write_string(const char *s);
+void __real_serial_write_pgm_string(const char *s);
+uint8_t __real_gc_execute_line(char *line);
+#ifdef USE_LINE_NUMBERS
+  void __real_plan_buffer_line(float *target, float feed_rate, uint8_t invert_feed_rate, int32_t line_number);
+#else
+  void __real_plan_buffer_line(float *target, float feed_rate, uint8_t invert_feed_rate);
+#endif
+
+#define SIM_QUANTUM (F_CPU/1000) // Simulated time advanced per main loop service call (1ms)
+#define SIM_STALL_LIMIT (60ULL*F_CPU) // Abort when the machine makes no progress for a minute.
+#define SIM_EEPROM_WRITE_TICKS (34*F_CPU/10000) // EEPROM programming time (3.4ms)
+
+static struct {
+  uint64_t now;                // Simulated CPU cycles since power-up
+  uint64_t t1_next;            // Next Timer1 compare event
+  uint64_t t2_next;            // Next Timer2 compare event
+  uint64_t adc_next;           // Next ADC conversion complete event
+  uint64_t ee_next;            // Next EEPROM ready interrupt
+  uint8_t t1_armed;
+  uint8_t t2_armed;
+  uint8_t adc_busy;
+  uint8_t ee_armed;
+  uint8_t in_isr;
+  uint64_t last_progress;
+
+  uint8_t eeprom[E2END+1];
+  uint64_t eeprom_writes;      // Programmed EEPROM bytes
+  uint8_t eecr;
+  uint8_t eedr;
+  uint8_t adcsra;
+  uint16_t adc_value[8];
+
+  FILE *input;
+  uint8_t input_done;
+  uint64_t input_wait;         // Input is held back until this time by a ";wait <ms>" line
+  uint64_t inject_time[8];     // Realtime characters scheduled by ";at <ms> <char>" lines
+  uint8_t inject_char[8];
+  uint8_t n_inject;
+  uint8_t index_sensor;        // Set by an ";index <deg> <w>" line
+  float index_start, index_width;
+  int32_t table_position;      // X position in steps, kept across position resets of the firmware
+  #ifdef SYNC_BUS
+    uint64_t sync_time[8];     // Next edge of the sync input pulses scheduled by ";sync <ms>" lines
+    uint8_t n_sync;
+    uint8_t sync_out;
+  #endif
+  uint8_t quiet;
+
+  // Step output statistics
+  uint64_t steps;
+  uint64_t first_step, last_step;
+  uint64_t min_interval, max_interval;
+  uint8_t stepping;            // True from the first step until the stepper goes idle
+  uint64_t isr_calls;
+  uint16_t ocr1a;              // Timer1 compare register
+  uint8_t tcnt2;               // Timer2 counter
+  uint64_t t2b_last;           // Time of the last Timer2 compare B interrupt
+  uint64_t segments;           // Segments loaded by the stepper interrupt
+  uint64_t segment_time;       // Time of the last segment load. Zero when the stepper is idle.
+  uint64_t min_segment, max_segment, sum_segment;
+  uint64_t timed_segments;
+  uint64_t triggers;
+  int32_t trigger_position;
+  uint64_t laser_switches;
+  uint8_t laser_port;
+  uint64_t laser_time;         // Time of the last laser output update
+  double laser_on_time[8];     // Lit time of each laser port bit, in cycles
+
+  // Host timing statistics. Time spent simulating the hardware is left out of the figures.
+  uint64_t advance_ns;
+  uint8_t advance_depth;
+  uint64_t lines, line_ns;
+  uint64_t blocks, block_ns;
+  uint64_t preps, prep_ns;
+} sim;
+
+
+static uint64_t host_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+
+// Host time of a firmware call, less the time it spent advancing the simulated hardware, such as
+// waiting for the motion to finish.
+typedef struct {
+  uint64_t start;
+  uint64_t advance;
+} host_timer_t;
+
+static void host_timer_start(host_timer_t *timer)
+{
+  timer->advance = sim.advance_ns;
+  timer->start = host_ns();
+}
+
+static uint64_t host_timer_stop(host_timer_t *timer)
+{
+  return host_ns() - timer->start - (sim.advance_ns - timer->advance);
+}
+
+
+char *itoa(int value, char *string, int radix)
+{
+  if (radix == 16) { sprintf(string, "%x", value); }
+  else if (radix == 8) { sprintf(string, "%o", value); }
+  else { sprintf(string, "%d", value); }
+  return string;
+}
+
+
+// Timer prescaler divisors, indexed by the CSn2:0 clock select bits.
+static uint32_t timer1_prescaler(void)
+{
+  static const uint32_t div[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+  return div[TCCR1B & 0x07];
+}
+
+static uint32_t timer2_prescaler(void)
+{
+  static const uint32_t div[8] = { 0, 1, 8, 32, 64, 128, 256, 1024 };
+  return div[TCCR2B & 0x07];
+}
+
+
+// Call an interrupt handler the way the CPU would: interrupts disabled on entry and restored on exit.
+static void sim_interrupt(void (*vector)(void))
+{
+  uint8_t sreg = SREG;
+  uint8_t in_isr = sim.in_isr;
+  SREG &= ~(1<<SREG_I);
+  sim.in_isr = true;
+  vector();
+  sim.in_isr = in_isr;
+  SREG = sreg;
+}
+
+
+// Drive the probe pin from the index sensor position, and raise its pin change interrupt when enabled.
+static void sim_check_index(void)
+{
+  if (!sim.index_sensor) { return; }
+  float revolution = 360*settings.steps_per_deg[X_AXIS];
+  float angle = fmodf(sim.table_position-sim.index_start*settings.steps_per_deg[X_AXIS], revolution);
+  if (angle < 0) { angle += revolution; }
+  uint8_t triggered = (angle < sim.index_width*settings.steps_per_deg[X_AXIS]);
+  uint8_t level = (triggered ^ bit_isfalse(settings.flags,BITFLAG_INVERT_PROBE_PIN)) ? PROBE_MASK : 0;
+  if ((PROBE_PIN & PROBE_MASK) == level) { return; }
+  PROBE_PIN = (PROBE_PIN & ~PROBE_MASK) | level;
+  #ifdef PROBE_PIN_INTERRUPT
+    if ((PCICR & (1<<PROBE_INT)) && (PROBE_PCMSK & PROBE_MASK) && PROBE_INT_vect) { sim_interrupt(PROBE_INT_vect); }
+  #endif
+}
+
+
+#ifdef SYNC_BUS
+// Drive the sync input pulses. Each falls at its time and rises again 1 ms later, and the pin change
+// interrupt sees both edges. Also logs the sync output. Returns the time of the next pending edge.
+static uint64_t sim_check_sync(void)
+{
+  uint64_t next = UINT64_MAX;
+  uint8_t i;
+  for (i = 0; i < sim.n_sync; i++) {
+    if (sim.sync_time[i] && sim.sync_time[i] <= sim.now) {
+      uint8_t high = SYNC_IN_PIN & SYNC_IN_MASK;
+      SYNC_IN_PIN ^= SYNC_IN_MASK;
+      sim.sync_time[i] = high ? sim.now + F_CPU/1000 : 0;
+      if ((PCICR & (1<<SYNC_INT)) && (SYNC_PCMSK & SYNC_IN_MASK)) { sim_interrupt(SYNC_INT_vect); }
+    }
+    if (sim.sync_time[i] && sim.sync_time[i] < next) { next = sim.sync_time[i]; }
+  }
+  uint8_t out = (SYNC_OUT_PORT & SYNC_OUT_MASK) ? 1 : 0;
+  if (out != sim.sync_out) {
+    sim.sync_out = out;
+    if (!sim.quiet) {
+      fprintf(stderr, "sim: sync out %u at %ld steps, %.3f s\n", out, (long)sys.position[X_AXIS], (double)sim.now/F_CPU);
+    }
+  }
+  return next;
+}
+#endif
+
+
+// Fire the stepper interrupt. Steps are counted from the machine position the interrupt updates,
+// since the step pin may already be high when the pulse reset is still pending.
+static void sim_stepper_event(void)
+{
+  #ifdef CAMERA_TRIGGER
+    uint8_t before = TRIGGER_PORT;
+  #endif
+  int32_t position = sys.position[X_AXIS];
+  sim_interrupt(TIMER1_COMPA_vect);
+  sim.isr_calls++;
+  if (sys.position[X_AXIS] != position) {
+    if (sim.stepping) {
+      // Step intervals are only taken within a run, not across the pauses between moves.
+      uint64_t interval = sim.now - sim.last_step;
+      if (interval < sim.min_interval || !sim.min_interval) { sim.min_interval = interval; }
+      if (interval > sim.max_interval) { sim.max_interval = interval; }
+    }
+    if (!sim.steps) { sim.first_step = sim.now; }
+    sim.stepping = true;
+    sim.last_step = sim.now;
+    sim.steps++;
+    sim.table_position += sys.position[X_AXIS]-position;
+    sim.last_progress = sim.now;
+  }
+  #ifdef CAMERA_TRIGGER
+    if ((TRIGGER_PORT ^ before) & TRIGGER_MASK & ~before) { sim.triggers++; sim.trigger_position = sys.position[X_AXIS]; }
+  #endif
+  sim_check_index();
+  // The step port reset timer always fires well before the next stepper tick.
+  if (TCCR0B && (TIMSK0 & (1<<TOIE0))) { sim_interrupt(TIMER0_OVF_vect); }
+}
+
+
+// Log laser output changes with the position they happened at, and integrate the lit time of each
+// laser. A laser on the OC2B pin in PWM mode is lit for OCR2B/(OCR2A+1) of the time.
+static void sim_check_lasers(void)
+{
+  int i;
+  double elapsed = (double)(sim.now - sim.laser_time);
+  for (i = 0; i < 8; i++) {
+    if (!(LASER_MASK & (1<<i))) { continue; }
+    if (sim.laser_port & (1<<i)) { sim.laser_on_time[i] += elapsed; }
+  }
+  #ifdef LASER_PWM
+    if (TCCR2A & (1<<COM2B1)) { sim.laser_on_time[LASER2_BIT] += elapsed*OCR2B/(OCR2A+1); }
+  #endif
+  sim.laser_time = sim.now;
+
+  uint8_t lasers = LASER_PORT & LASER_MASK;
+  if (lasers != sim.laser_port) {
+    sim.laser_port = lasers;
+    sim.laser_switches++;
+    if (!sim.quiet) {
+      fprintf(stderr, "sim: lasers 0x%02x at %ld steps, %.3f s\n", lasers, (long)sys.position[X_AXIS], (double)sim.now/F_CPU);
+    }
+  }
+}
+
+
+// Drain the serial transmit buffer to stdout through the data register empty interrupt.
+static void sim_serial_tx(void)
+{
+  while (UCSR0B & (1<<UDRIE0)) {
+    sim_interrupt(SERIAL_UDRE);
+    if (!sim.quiet) { putchar(UDR0); }
+  }
+}
+
+
+// Advance simulated time, firing every peripheral event that falls due on the way.
+static void sim_advance(uint64_t cycles)
+{
+  uint64_t end = sim.now + cycles;
+  if (sim.in_isr) { sim.now = end; return; } // Delays inside handlers just burn time.
+
+  uint64_t start = host_ns();
+  sim.advance_depth++;
+  for (;;) {
+    sim_check_lasers();
+    #ifdef SYNC_BUS
+      uint64_t sync_next = sim_check_sync();
+    #endif
+    // Deliver scheduled realtime characters through the receive interrupt.
+    uint8_t i;
+    for (i = 0; i < sim.n_inject; i++) {
+      if (sim.inject_char[i] && sim.inject_time[i] <= sim.now) {
+        UDR0 = sim.inject_char[i];
+        sim.inject_char[i] = 0;
+        sim_interrupt(SERIAL_RX);
+      }
+    }
+    // Arm or disarm the timers according to their interrupt enable bits.
+    if (TIMSK1 & (1<<OCIE1A)) {
+      if (!sim.t1_armed) { sim.t1_armed = true; sim.t1_next = sim.now + (uint64_t)(sim.ocr1a+1)*timer1_prescaler(); }
+    } else {
+      sim.t1_armed = false;
+      sim.stepping = false;
+      sim.segment_time = 0;
+    }
+    if ((TIMSK2 & (1<<OCIE2A)) && timer2_prescaler()) {
+      if (!sim.t2_armed) { sim.t2_armed = true; sim.t2_next = sim.now + (uint64_t)(OCR2A+1)*timer2_prescaler(); }
+    } else { sim.t2_armed = false; }
+    // The compare B match falls at OCR2B counts into the running period, or else into the next one.
+    uint8_t t2b_armed = sim.t2_armed && (TIMSK2 & (1<<OCIE2B)) && TIMER2_COMPB_vect;
+    uint64_t t2b_next = 0;
+    if (t2b_armed) {
+      uint64_t period = (uint64_t)(OCR2A+1)*timer2_prescaler();
+      t2b_next = sim.t2_next - period + (uint64_t)OCR2B*timer2_prescaler();
+      if (t2b_next < sim.now || t2b_next <= sim.t2b_last) { t2b_next += period; }
+    }
+
+    if ((sim.adcsra & (1<<ADSC)) && (sim.adcsra & (1<<ADIE)) && !sim.adc_busy) {
+      sim.adc_busy = true;
+      sim.adc_next = sim.now + 13*128;
+    }
+
+    // The ready interrupt fires once the write in progress has had its programming time.
+    if ((sim.eecr & (1<<EERIE)) && EE_READY_vect) {
+      if (!sim.ee_armed) {
+        sim.ee_armed = true;
+        sim.ee_next = sim.now + ((sim.eecr & (1<<EEPE)) ? SIM_EEPROM_WRITE_TICKS : 0);
+      }
+    } else { sim.ee_armed = false; }
+
+    uint64_t next = end;
+    if (sim.t1_armed && sim.t1_next < next) { next = sim.t1_next; }
+    if (sim.t2_armed && sim.t2_next < next) { next = sim.t2_next; }
+    if (t2b_armed && t2b_next < next) { next = t2b_next; }
+    if (sim.adc_busy && sim.adc_next < next) { next = sim.adc_next; }
+    if (sim.ee_armed && sim.ee_next < next) { next = sim.ee_next; }
+    for (i = 0; i < sim.n_inject; i++) {
+      if (sim.inject_char[i] && sim.inject_time[i] < next) { next = sim.inject_time[i]; }
+    }
+    #ifdef SYNC_BUS
+      if (sync_next < next) { next = sync_next; }
+    #endif
+    if (next < sim.now) { next = sim.now; } // Events overdue after a delay inside a handler
+    sim.now = next;
+    if (next >= end) { break; }
+
+    if (sim.t1_armed && sim.t1_next <= next) {
+      sim_stepper_event();
+      sim.t1_next = sim.now + (uint64_t)(sim.ocr1a+1)*timer1_prescaler();
+    }
+    if (sim.t2_armed && sim.t2_next <= next) {
+      if (TIMER2_COMPA_vect) { sim_interrupt(TIMER2_COMPA_vect); }
+      sim.t2_next = sim.now + (uint64_t)(OCR2A+1)*timer2_prescaler();
+    }
+    if (t2b_armed && t2b_next <= next && (TIMSK2 & (1<<OCIE2B))) {
+      sim.t2b_last = sim.now;
+      sim_interrupt(TIMER2_COMPB_vect);
+    }
+    if (sim.adc_busy && sim.adc_next <= next) {
+      sim.adc_busy = false;
+      ADCW = sim.adc_value[ADMUX & 0x07] + (rand() % 3) - 1; // +-1 LSB noise
+      sim.adcsra &= ~(1<<ADSC);
+      sim.adcsra |= (1<<ADIF);
+      if ((sim.adcsra & (1<<ADIE)) && ADC_vect) { sim.adcsra &= ~(1<<ADIF); sim_interrupt(ADC_vect); }
+    }
+    if (sim.ee_armed && sim.ee_next <= next) {
+      sim.ee_armed = false;
+      sim_ee_reg_eecr(); // Completes the write
+      sim_interrupt(EE_READY_vect);
+    }
+  }
+  sim_serial_tx();
+  if (--sim.advance_depth == 0) { sim.advance_ns += host_ns() - start; }
+}
+
+
+void sim_delay_us(double us)
+{
+  sim_advance((uint64_t)(us*TICKS_PER_MICROSECOND));
+}
+
+
+// Timer1 compare register. The stepper interrupt loads it with the step rate of every new segment,
+// so its accesses from the interrupt mark the segment boundaries.
+volatile uint16_t *sim_timer1_reg_ocr1a(void)
+{
+  if (sim.in_isr) {
+    if (sim.segment_time) {
+      uint64_t duration = sim.now - sim.segment_time;
+      if (duration < sim.min_segment || !sim.timed_segments) { sim.min_segment = duration; }
+      if (duration > sim.max_segment) { sim.max_segment = duration; }
+      sim.sum_segment += duration;
+      sim.timed_segments++;
+    }
+    sim.segment_time = sim.now;
+    sim.segments++;
+  }
+  return (volatile uint16_t *)&sim.ocr1a;
+}
+
+
+// Timer2 counter. Counts up from the start of the running compare period. The compare event is
+// only fired by sim_advance(), so the counter stops at TOP until it does.
+volatile uint8_t *sim_timer2_reg_tcnt2(void)
+{
+  if (sim.t2_armed) {
+    uint64_t period = (uint64_t)(OCR2A+1)*timer2_prescaler();
+    uint64_t elapsed = sim.now + period - sim.t2_next;
+    sim.tcnt2 = (elapsed >= period) ? OCR2A : elapsed/timer2_prescaler();
+  }
+  return (volatile uint8_t *)&sim.tcnt2;
+}
+
+
+// ADC control register. Polled conversions started with ADSC complete after 13 ADC clocks.
+volatile uint8_t *sim_adc_reg_adcsra(void)
+{
+  if ((sim.adcsra & (1<<ADSC)) && !sim.adc_busy) {
+    if (sim.adcsra & (1<<ADIE)) {
+      sim.adc_busy = true;
+      sim.adc_next = sim.now + 13*128;
+    } else {
+      ADCW = sim.adc_value[ADMUX & 0x07];
+      sim.adcsra &= ~(1<<ADSC);
+      sim.adcsra |= (1<<ADIF);
+    }
+  }
+  return (volatile uint8_t *)&sim.adcsra;
+}
+
+
+// EEPROM control register. Completes any pending programming operation when polled. Writes are
+// only timed when serviced by the ready interrupt.
+volatile uint8_t *sim_ee_reg_eecr(void)
+{
+  if (sim.eecr & (1<<EEPE)) {
+    uint16_t addr = EEAR & E2END;
+    switch ((sim.eecr >> 4) & 0x03) {
+      case 0: sim.eeprom[addr] = sim.eedr; break;   // Erase and write
+      case 1: sim.eeprom[addr] = 0xff; break;       // Erase only
+      case 2: sim.eeprom[addr] &= sim.eedr; break;  // Write only
+    }
+    sim.eeprom_writes++;
+    sim.eecr &= ~((1<<EEPE)|(1<<EEMPE));
+  }
+  return (volatile uint8_t *)&sim.eecr;
+}
+
+
+// EEPROM data register. Returns the addressed byte after a read strobe.
+volatile uint8_t *sim_ee_reg_eedr(void)
+{
+  if (sim.eecr & (1<<EERE)) {
+    sim.eedr = sim.eeprom[EEAR & E2END];
+    sim.eecr &= ~(1<<EERE);
+  }
+  return (volatile uint8_t *)&sim.eedr;
+}
+
+
+static void sim_report(void)
+{
+  int i;
+  sim_check_lasers();
+  double seconds = (double)sim.now/F_CPU;
+  fprintf(stderr, "\n---- simulation report ----\n");
+  fprintf(stderr, "simulated time:      %.3f s\n", seconds);
+  fprintf(stderr, "steps:               %llu\n", (unsigned long long)sim.steps);
+  fprintf(stderr, "final position:      %ld steps\n", (long)sys.position[X_AXIS]);
+  if (sim.steps > 1) {
+    double span = (double)(sim.last_step - sim.first_step)/F_CPU;
+    fprintf(stderr, "motion time:         %.3f s\n", span);
+  }
+  if (sim.min_interval) {
+    fprintf(stderr, "step interval:       min %.2f us, max %.2f us\n",
+            (double)sim.min_interval/TICKS_PER_MICROSECOND, (double)sim.max_interval/TICKS_PER_MICROSECOND);
+    fprintf(stderr, "peak step rate:      %.1f Hz\n", (double)F_CPU/sim.min_interval);
+  }
+  fprintf(stderr, "stepper ISR calls:   %llu\n", (unsigned long long)sim.isr_calls);
+  fprintf(stderr, "segments:            %llu\n", (unsigned long long)sim.segments);
+  if (sim.timed_segments) {
+    fprintf(stderr, "segment time:        min %.3f ms, avg %.3f ms, max %.3f ms\n",
+            (double)sim.min_segment*1e3/F_CPU, (double)sim.sum_segment*1e3/F_CPU/sim.timed_segments,
+            (double)sim.max_segment*1e3/F_CPU);
+  }
+  fprintf(stderr, "eeprom writes:       %llu\n", (unsigned long long)sim.eeprom_writes);
+  fprintf(stderr, "laser switches:      %llu\n", (unsigned long long)sim.laser_switches);
+  fprintf(stderr, "laser lit time:     ");
+  for (i = 0; i < 8; i++) {
+    if (LASER_MASK & (1<<i)) { fprintf(stderr, " %.3f", sim.laser_on_time[i]/F_CPU); }
+  }
+  fprintf(stderr, " s\n");
+  #ifdef CAMERA_TRIGGER
+    fprintf(stderr, "camera triggers:     %llu (last at %ld steps)\n", (unsigned long long)sim.triggers, (long)sim.trigger_position);
+  #endif
+  if (sim.lines) {
+    fprintf(stderr, "g-code lines:        %llu (%.0f lines/s host, %.2f us/line)\n", (unsigned long long)sim.lines,
+            sim.lines*1e9/sim.line_ns, sim.line_ns/1e3/sim.lines);
+  }
+  if (sim.blocks) {
+    fprintf(stderr, "planner blocks:      %llu (%.0f blocks/s host, %.2f us/block)\n", (unsigned long long)sim.blocks,
+            sim.blocks*1e9/sim.block_ns, sim.block_ns/1e3/sim.blocks);
+  }
+  if (sim.preps) {
+    fprintf(stderr, "segment prep calls:  %llu (%.2f us/call host)\n", (unsigned long long)sim.preps,
+            sim.prep_ns/1e3/sim.preps);
+  }
+}
+
+
+static void sim_check_stall(void)
+{
+  if (sim.now - sim.last_progress > SIM_STALL_LIMIT) {
+    fflush(stdout);
+    fprintf(stderr, "\nsim: no step progress for %llu s of simulated time (state %d). Missing M17?\n",
+            (unsigned long long)(SIM_STALL_LIMIT/F_CPU), sys.state);
+    sim_report();
+    exit(2);
+  }
+}
+
+
+// Planner queries also poll the main loop while a feed hold waits for cycle start. Time keeps running there.
+plan_block_t *__real_plan_get_current_block(void);
+plan_block_t *__wrap_plan_get_current_block(void)
+{
+  if (!sim.in_isr && sys.state == STATE_QUEUED) { sim_advance(SIM_QUANTUM); }
+  return __real_plan_get_current_block();
+}
+
+
+// Timer polls wait for a dwell to run out, with the main program otherwise idle. Time keeps running there.
+uint8_t __real_timer_expired(uint8_t id);
+uint8_t __wrap_timer_expired(uint8_t id)
+{
+  uint8_t expired = __real_timer_expired(id);
+  if (!expired && !sim.in_isr && id == TIMER_DWELL) {
+    sim_advance(SIM_QUANTUM/10);
+    sim.last_progress = sim.now; // A dwell is no stall.
+  }
+  return expired;
+}
+
+
+#ifdef LASER_PULSE
+// Laser pulse polls wait for the pulse to end, as the dwell timer polls do.
+uint8_t __real_laser_pulse_active(void);
+uint8_t __wrap_laser_pulse_active(void)
+{
+  uint8_t active = __real_laser_pulse_active();
+  if (active && !sim.in_isr) { sim_advance(SIM_QUANTUM/100); }
+  return active;
+}
+#endif
+
+
+// Main loop service point. Lets simulated hardware run for one quantum after the segment buffer is refilled.
+void __wrap_st_prep_buffer(void)
+{
+  host_timer_t timer;
+  host_timer_start(&timer);
+  __real_st_prep_buffer();
+  sim.prep_ns += host_timer_stop(&timer);
+  sim.preps++;
+  if (!sim.in_isr) {
+    sim_advance(SIM_QUANTUM);
+    sim_check_stall();
+  }
+}
+
+
+// Serial input. Feeds the next line of the input file whenever the firmware has consumed the last one.
+uint8_t __wrap_serial_read(void)
+{
+  if (serial_get_rx_buffer_count()) { return __real_serial_read(); }
+
+  sim_serial_tx();
+  if (!sim.input_done && sim.now < sim.input_wait) {
+    sim_advance(SIM_QUANTUM);
+  } else if (!sim.input_done) {
+    // A ";wait <ms>" line holds back the input, so realtime commands land mid-motion.
+    int w = fgetc(sim.input);
+    if (w == ';') {
+      unsigned ms = 0;
+      char c;
+      if (fscanf(sim.input, "wait %u", &ms) == 1) { sim.input_wait = sim.now + (uint64_t)ms*(F_CPU/1000); }
+      else if (fscanf(sim.input, "at %u %c", &ms, &c) == 2 && sim.n_inject < 8) {
+        sim.inject_time[sim.n_inject] = sim.now + (uint64_t)ms*(F_CPU/1000);
+        sim.inject_char[sim.n_inject++] = c;
+      } else if (fscanf(sim.input, "index %f %f", &sim.index_start, &sim.index_width) == 2) {
+        sim.index_sensor = true;
+        sim_check_index();
+      }
+      #ifdef SYNC_BUS
+        else if (fscanf(sim.input, "sync %u", &ms) == 1 && sim.n_sync < 8) {
+          sim.sync_time[sim.n_sync++] = sim.now + (uint64_t)ms*(F_CPU/1000);
+        }
+      #endif
+      while ((w = fgetc(sim.input)) != EOF && w != '\n') { }
+      return __real_serial_read();
+    }
+    if (w != EOF) { ungetc(w, sim.input); }
+    // Feed one input line, or one binary packet, through the receive interrupt.
+    int c, n = 0, packet = 0;
+    while ((c = fgetc(sim.input)) != EOF) {
+      UDR0 = c;
+      sim_interrupt(SERIAL_RX);
+      n++;
+      #ifdef BINARY_PROTOCOL
+        if (!packet && c == PACKET_START && n == 1) { packet = PACKET_SIZE-1; continue; }
+        if (packet) { if (--packet == 0) { break; } continue; }
+      #endif
+      if (c == '\n') { break; }
+    }
+    if (n) {
+      if (c == EOF && !packet) { UDR0 = '\n'; sim_interrupt(SERIAL_RX); }
+      sim.last_progress = sim.now;
+    } else {
+      sim.input_done = true;
+    }
+  } else if ((sys.state == STATE_IDLE || sys.state == STATE_ALARM) && !plan_get_current_block()) {
+    sim_serial_tx();
+    fflush(stdout);
+    sim_report();
+    exit(0);
+  } else {
+    sim_advance(SIM_QUANTUM);
+    sim_check_stall();
+  }
+  return __real_serial_read();
+}
+
+
+// Serial output. The transmitter is modelled as infinitely fast so the firmware never blocks on it.
+void __wrap_serial_write(uint8_t data)
+{
+  sim_check_lasers();
+  __real_serial_write(data);
+  sim_serial_tx();
+}
+
+
+// Strings go in runs shorter than the serial TX buffer, drained after each, for the same reason.
+#define SIM_TX_RUN (TX_BUFFER_SIZE/2)
+static void sim_serial_write_chars(const char *s, void (*write)(const char *))
+{
+  char run[SIM_TX_RUN+1];
+  size_t length = strlen(s);
+  sim_check_lasers();
+  while (length) {
+    size_t n = (length < SIM_TX_RUN ? length : SIM_TX_RUN);
+    memcpy(run, s, n);
+    run[n] = '\0';
+    write(run);
+    sim_serial_tx();
+    s += n;
+    length -= n;
+  }
+}
+
+
+void __wrap_serial_write_string(const char *s) { sim_serial_write_chars(s, __real_serial_write_string); }
+
+
+void __wrap_serial_write_pgm_string(const char *s) { sim_serial_write_chars(s, __real_serial_write_pgm_string); }
+
+
+uint8_t __wrap_gc_execute_line(char *line)
+{
+  host_timer_t timer;
+  host_timer_start(&timer);
+  uint8_t status = __real_gc_execute_line(line);
+  sim.line_ns += host_timer_stop(&timer);
+  sim.lines++;
+  return status;
+}
+
+
+#ifdef USE_LINE_NUMBERS
+  void __wrap_plan_buffer_line(float *target, float feed_rate, uint8_t invert_feed_rate, int32_t line_number)
+#else
+  void __wrap_plan_buffer_line(float *target, float feed_rate, uint8_t invert_feed_rate)
+#endif
+{
+  host_timer_t timer;
+  host_timer_start(&timer);
+  #ifdef USE_LINE_NUMBERS
+    __real_plan_buffer_line(target, feed_rate, invert_feed_rate, line_number);
+  #else
+    __real_plan_buffer_line(target, feed_rate, invert_feed_rate);
+  #endif
+  sim.block_ns += host_timer_stop(&timer);
+  sim.blocks++;
+}
+
+
+int main(int argc, char *argv[])
+{
+  int i;
+  memset(sim.eeprom, 0xff, sizeof(sim.eeprom));
+  for (i = 0; i < 8; i++) { sim.adc_value[i] = 100*i + 50; }
+  sim.input = stdin;
+  #ifdef SYNC_BUS
+    SYNC_IN_PIN |= SYNC_IN_MASK; // The input idles high on its pull-up.
+  #endif
+  for (i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-q")) { sim.quiet = true; }
+    else if (!(sim.input = fopen(argv[i], "r"))) { perror(argv[i]); return 1; }
+  }
+  return firmware_main();
+}
@@ -30,6 +30,9 @@
 #include "settings.h"
 #include "planner.h"
 #include "probe.h"
+#include "ldr.h"
+#include "laser_control.h"
+#include "report.h"
 
 
 // Some useful constants.
@@ -38,6 +41,24 @@
 #define RAMP_ACCEL 0
 #define RAMP_CRUISE 1
 #define RAMP_DECEL 2
+#define RAMP_DECEL_OVERRIDE 3 // Deceleration to a nominal speed reduced by the feed override
+
+#ifdef FIXED_POINT_PLANNER
+  // Fixed-point segment prep units. Distances are in substeps of 1/256 step and speeds are in 1/65536
+  // step per segment time, so a segment distance is a shift of its average speed and the ramps change
+  // the speed by a constant increment per segment.
+  #define PREP_SUBSTEP_BITS 8
+  #define PREP_SPEED_BITS 16
+  #define PREP_DISTANCE_SHIFT (1+PREP_SPEED_BITS-PREP_SUBSTEP_BITS) // Sum of two speeds to substeps
+  #define PREP_CYCLES_PER_SEGMENT (F_CPU/ACCELERATION_TICKS_PER_SECOND)
+  #define PREP_SEGMENTS_PER_SEC_SQR ((uint32_t)ACCELERATION_TICKS_PER_SECOND*ACCELERATION_TICKS_PER_SECOND)
+#endif
+
+#ifdef RAMP_TABLE
+  #define RAMP_TABLE_SHIFT 24 // Fixed-point bits of the inverse speed increment. Speed sums stay below 2^24.
+  #define RAMP_TABLE_INTERPOLATION_MIN 8 // First entry interpolated between. Divided below it.
+  #define RAMP_TABLE_MAX_CYCLES (1UL << 22) // Slowest step timing. Keeps the interpolation within 32 bits.
+#endif
 
 // Define Adaptive Multi-Axis Step-Smoothing(AMASS) levels and cutoff frequencies. The highest level
 // frequency bin starts at 0Hz and ends at its cutoff frequency. The next lower level frequency bin
@@ -63,8 +84,16 @@
 // data for its own use. 
 typedef struct {  
   uint8_t direction_bits;
-  uint32_t steps[N_AXIS];
-  uint32_t step_event_count;
+  #ifndef SINGLE_AXIS_STEPPER // The lone axis steps every tick and needs no line data.
+    uint32_t steps[N_AXIS];
+    uint32_t step_event_count;
+  #endif
+  #ifdef LASER_MOTION_SYNC
+    uint8_t laser_state;
+  #endif
+  #ifdef LDR_READ_QUEUE
+    uint8_t ldr_read_mark;
+  #endif
 } st_block_t;
 static st_block_t st_block_buffer[SEGMENT_BUFFER_SIZE-1];
 
@@ -81,15 +110,20 @@ typedef struct {
   #else
     uint8_t prescaler;      // Without AMASS, a prescaler is required to adjust for slow timing.
   #endif
+  #ifdef CAMERA_TRIGGER
+    uint8_t end_of_block;   // Flags the last segment of a planner block for the camera trigger.
+  #endif
 } segment_t;
 static segment_t segment_buffer[SEGMENT_BUFFER_SIZE];
 
 // Stepper ISR data struct. Contains the running data for the main stepper ISR.
 typedef struct {
-  // Used by the bresenham line algorithm
-  uint32_t counter_x,        // Counter variables for the bresenham line tracer
-           counter_y, 
-           counter_z;
+  #ifndef SINGLE_AXIS_STEPPER
+    // Used by the bresenham line algorithm
+    uint32_t counter_x,        // Counter variables for the bresenham line tracer
+             counter_y, 
+             counter_z;
+  #endif
   #ifdef STEP_PULSE_DELAY
     uint8_t step_bits;  // Stores out_bits output to complete the step pulse delay
   #endif
@@ -102,6 +136,17 @@ typedef struct {
     uint32_t steps[N_AXIS];
   #endif
 
+  #ifdef CAMERA_TRIGGER
+    uint8_t trigger;           // Flags a camera trigger pulse with the next step pulse
+    uint16_t trigger_interval; // Steps between camera triggers. Zero triggers at end of block.
+    uint16_t trigger_count;    // Steps since the last camera trigger
+  #endif
+
+  #ifdef STEP_TRACE
+    uint32_t trace_time;       // Stepper clock. CPU cycles of the elapsed ISR ticks.
+    uint32_t tick_cycles;      // CPU cycles of the ISR tick period loaded with the running segment
+  #endif
+
   uint16_t step_count;       // Steps remaining in line segment motion  
   uint8_t exec_block_index; // Tracks the current st_block index. Change indicates new block.
   st_block_t *exec_block;   // Pointer to the block data for the segment being executed
@@ -118,6 +163,19 @@ static uint8_t segment_next_head;
 static uint8_t step_port_invert_mask;
 static uint8_t dir_port_invert_mask;
 
+#ifdef STEP_TRACE
+  typedef struct {
+    uint32_t time;     // Stepper clock of the step pulse or segment start, in CPU cycles
+    int32_t position;  // Machine position of the X axis in steps
+  } st_trace_t;
+
+  // Trace records ring. Written by the stepper interrupt, keeping the latest STEP_TRACE_SIZE
+  // records. Sent by the main program when idle.
+  static st_trace_t st_trace_buffer[STEP_TRACE_SIZE];
+  static uint8_t st_trace_head;
+  static uint8_t st_trace_count;
+#endif
+
 // Used to avoid ISR nesting of the "Stepper Driver Interrupt". Should never occur though.
 static volatile uint8_t busy;
 static volatile uint8_t disable_motor;
@@ -132,23 +190,58 @@ static st_block_t *st_prep_block;  // Pointer to the stepper block data being pr
 typedef struct {
   uint8_t st_block_index;  // Index of stepper common data block being prepped
   uint8_t flag_partial_block;  // Flag indicating the last block completed. Time to load a new one.
-
-  float steps_remaining;
-  float step_per_deg;           // Current planner block step/deg conversion scalar
-  float req_deg_increment;
-  float dt_remainder;
+  uint8_t flag_decel_override; // Flag indicating the next block is entered at the exit speed of a
+                               // feed override deceleration, above its planned entry speed.
+
+  #ifdef FIXED_POINT_PLANNER
+    uint32_t substeps_remaining; // Distance remaining in the planner block (substeps)
+
+    uint8_t ramp_type;           // Current segment ramp state
+    uint32_t substeps_complete;  // End of velocity profile from end of current planner block (substeps).
+                                 // NOTE: This value must coincide with a step.
+    uint32_t current_speed;      // Current speed at the end of the segment buffer (prep speed units)
+    uint32_t maximum_speed;      // Maximum speed of executing block. Not always nominal speed.
+    uint32_t exit_speed;         // Exit speed of executing block
+    uint32_t speed_increment;    // Speed change per segment at the block acceleration
+    uint32_t accelerate_until;   // Acceleration ramp end measured from end of block (substeps)
+    uint32_t decelerate_after;   // Deceleration ramp start measured from end of block (substeps)
+  #else
+    float steps_remaining;
+    float step_per_deg;           // Current planner block step/deg conversion scalar
+    float req_deg_increment;
+    float dt_remainder;
   
-  uint8_t ramp_type;      // Current segment ramp state
-  float deg_complete;      // End of velocity profile from end of current planner block in (deg).
-                          // NOTE: This value must coincide with a step(no mantissa) when converted.
-  float current_speed;    // Current speed at the end of the segment buffer (deg/min)
-  float maximum_speed;    // Maximum speed of executing block. Not always nominal speed. (deg/min)
-  float exit_speed;       // Exit speed of executing block (deg/min)
-  float accelerate_until; // Acceleration ramp end measured from end of block (deg)
-  float decelerate_after; // Deceleration ramp start measured from end of block (deg)
+    uint8_t ramp_type;      // Current segment ramp state
+    float deg_complete;      // End of velocity profile from end of current planner block in (deg).
+                            // NOTE: This value must coincide with a step(no mantissa) when converted.
+    float current_speed;    // Current speed at the end of the segment buffer (deg/min)
+    float maximum_speed;    // Maximum speed of executing block. Not always nominal speed. (deg/min)
+    float exit_speed;       // Exit speed of executing block (deg/min)
+    float accelerate_until; // Acceleration ramp end measured from end of block (deg)
+    float decelerate_after; // Deceleration ramp start measured from end of block (deg)
+    #ifdef S_CURVE_ACCELERATION
+      float ramp_start_speed;  // Speed at the start of the current S-curve ramp (deg/min)
+      float ramp_delta_speed;  // Speed change over the ramp. Negative when decelerating. (deg/min)
+      float ramp_start_deg;    // Ramp start measured from end of block (deg)
+      float ramp_duration;     // Ramp time at the block acceleration (min)
+      float ramp_time;         // Time into the ramp at the end of the segment buffer (min)
+    #endif
+  #endif
 } st_prep_t;
 static st_prep_t prep;
 
+#ifdef RAMP_TABLE
+// Segment CPU cycles per step of the ramp speeds. Entry n holds the cycles of a segment with a speed
+// sum of n speed increments, so the segments of a ramp from rest land exactly on the entries.
+typedef struct {
+  uint32_t speed_increment;   // Speed increment the table is built for (prep speed units)
+  uint32_t inverse_increment; // 2^RAMP_TABLE_SHIFT/speed_increment, rounded down
+  uint32_t speed_limit;       // Speed sums from here on are divided. Zero for an unusable table.
+  uint32_t cycles[RAMP_TABLE_SIZE];
+} st_ramp_table_t;
+static st_ramp_table_t ramp_table;
+#endif
+
 
 /*    BLOCK VELOCITY PROFILE DEFINITION 
           __________________________
@@ -186,6 +279,10 @@ static st_prep_t prep;
   The step segment buffer computes the executing block velocity profile and tracks the critical
   parameters for the stepper algorithm to accurately trace the profile. These critical parameters 
   are shown and defined in the above illustration.
+
+  With S_CURVE_ACCELERATION, the speed follows the smoothstep 3*u^2-2*u^3 of the ramp time fraction u
+  between the ends of each acceleration and deceleration ramp. Its average is the ramp midpoint
+  speed, so the ramps keep the times and distances of the profiles above.
 */
 
 
@@ -201,6 +298,12 @@ void st_wake_up()
     // Initialize stepper output bits
     st.dir_outbits = dir_port_invert_mask; 
     st.step_outbits = step_port_invert_mask;
+
+    #ifdef CAMERA_TRIGGER
+      // Restart the camera trigger step count with every cycle.
+      st.trigger_interval = settings.trigger_step_interval;
+      st.trigger_count = 0;
+    #endif
     
     // Initialize step pulse timing from settings. Here to ensure updating after re-writing.
     #ifdef STEP_PULSE_DELAY
@@ -247,6 +350,33 @@ void st_go_idle()
 }
 
 
+#if defined(DIAGNOSTIC_COUNTERS) || defined(STEP_TRACE)
+  // Converts a Timer1 count to CPU cycles with the prescaler of the running segment. Saturates.
+  static uint16_t st_timer1_cycles(uint16_t ticks)
+  {
+    uint32_t cycles = ticks;
+    switch (TCCR1B & (0x07<<CS10)) {
+      case (2<<CS10): cycles <<= 3; break; // prescaler: 8
+      case (3<<CS10): cycles <<= 6; break; // prescaler: 64
+    }
+    if (cycles > 0xffff) { return(0xffff); }
+    return(cycles);
+  }
+#endif
+
+
+#ifdef STEP_TRACE
+  // Latches a trace record in the ring, overwriting the oldest one when full.
+  static void st_trace_record(uint32_t time)
+  {
+    st_trace_buffer[st_trace_head].time = time;
+    st_trace_buffer[st_trace_head].position = sys.position[X_AXIS];
+    if (++st_trace_head == STEP_TRACE_SIZE) { st_trace_head = 0; }
+    if (st_trace_count < STEP_TRACE_SIZE) { st_trace_count++; }
+  }
+#endif
+
+
 /* "The Stepper Driver Interrupt" - This timer interrupt is the workhorse of Grbl. Grbl employs
    the venerable Bresenham line algorithm to manage and exactly synchronize multi-axis moves.
    Unlike the popular DDA algorithm, the Bresenham algorithm is not susceptible to numerical
@@ -298,7 +428,16 @@ void st_go_idle()
 ISR(TIMER1_COMPA_vect)
 {        
 // SPINDLE_ENABLE_PORT ^= 1<<SPINDLE_ENABLE_BIT; // Debug: Used to time ISR
-  if (busy) { return; } // The busy-flag is used to avoid reentering this interrupt
+  if (busy) { // The busy-flag is used to avoid reentering this interrupt
+    #ifdef DIAGNOSTIC_COUNTERS
+      diag.isr_overrun++;
+    #endif
+    return; 
+  }
+  #ifdef DIAGNOSTIC_COUNTERS
+    // Timer1 restarts from zero at the compare match, so its count is the time since the tick.
+    uint16_t entry_cycles = st_timer1_cycles(TCNT1);
+  #endif
   
   // Set the direction pins a couple of nanoseconds before we step the steppers
   DIRECTION_PORT = (DIRECTION_PORT & ~DIRECTION_MASK) | (st.dir_outbits & DIRECTION_MASK);
@@ -310,6 +449,24 @@ ISR(TIMER1_COMPA_vect)
     STEP_PORT = (STEP_PORT & ~STEP_MASK) | st.step_outbits;
   #endif  
 
+  #ifdef STEP_TRACE
+    // Time the pulse on the stepper clock. The count of the restarted timer is the latency of
+    // this interrupt, so the record holds the actual pin time and shows any jitter.
+    st.trace_time += st.tick_cycles;
+    uint32_t trace_time = st.trace_time + st_timer1_cycles(TCNT1);
+  #endif
+
+  #ifdef CAMERA_TRIGGER
+    // Pulse the camera trigger together with the step it was flagged for.
+    if (st.trigger) {
+      TRIGGER_PORT |= TRIGGER_MASK;
+      st.trigger = false;
+      #ifdef LASER_PWM
+        laser_strobe_start(); // Open the strobe window of the strobed lasers
+      #endif
+    }
+  #endif
+
   // Enable step pulse reset timer so that The Stepper Port Reset Interrupt can reset the signal after
   // exactly settings.pulse_microseconds microseconds, independent of the main Timer1 prescaler.
   TCNT0 = st.step_pulse_time; // Reload Timer0 counter
@@ -318,6 +475,11 @@ ISR(TIMER1_COMPA_vect)
   busy = true;
   sei(); // Re-enable interrupts to allow Stepper Port Reset Interrupt to fire on-time. 
          // NOTE: The remaining code in this ISR will finish before returning to main program.
+
+  #if defined(STEP_TRACE) && !defined(STEP_TRACE_SEGMENTS)
+    // Record the step pulsed by this tick. The position was already counted when it was set up.
+    if ((st.step_outbits ^ step_port_invert_mask) & (1<<X_STEP_BIT)) { st_trace_record(trace_time); }
+  #endif
     
   // If there is no step segment, attempt to pop one from the stepper buffer
   if (st.exec_segment == NULL) {
@@ -334,16 +496,36 @@ ISR(TIMER1_COMPA_vect)
       // Initialize step segment timing per step and load number of steps to execute.
       OCR1A = st.exec_segment->cycles_per_tick;
       st.step_count = st.exec_segment->n_step; // NOTE: Can sometimes be zero when moving slow.
+      #ifdef STEP_TRACE
+        // The timer restarts from zero at the compare match, so a tick lasts one more count.
+        #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+          st.tick_cycles = (uint32_t)st.exec_segment->cycles_per_tick+1;
+        #else
+          st.tick_cycles = ((uint32_t)st.exec_segment->cycles_per_tick+1) << (3*(st.exec_segment->prescaler-1));
+        #endif
+        #ifdef STEP_TRACE_SEGMENTS
+          st_trace_record(trace_time);
+        #endif
+      #endif
       // If the new segment starts a new planner block, initialize stepper variables and counters.
       // NOTE: When the segment data index changes, this indicates a new planner block.
       if ( st.exec_block_index != st.exec_segment->st_block_index ) {
         st.exec_block_index = st.exec_segment->st_block_index;
         st.exec_block = &st_block_buffer[st.exec_block_index];
         
-        // Initialize Bresenham line and distance counters
-        st.counter_x = (st.exec_block->step_event_count >> 1);
-        st.counter_y = st.counter_x;
-        st.counter_z = st.counter_x;        
+        #ifndef SINGLE_AXIS_STEPPER
+          // Initialize Bresenham line and distance counters
+          st.counter_x = (st.exec_block->step_event_count >> 1);
+          st.counter_y = st.counter_x;
+          st.counter_z = st.counter_x;        
+        #endif
+
+        #ifdef LASER_MOTION_SYNC
+          laser_apply(st.exec_block->laser_state); // Apply the laser state queued with the block
+        #endif
+        #ifdef LDR_READ_QUEUE
+          ldr_read_latch(st.exec_block->ldr_read_mark); // Take the reads queued before the block
+        #endif
       }
 
       st.dir_outbits = st.exec_block->direction_bits ^ dir_port_invert_mask; 
@@ -357,6 +539,19 @@ ISR(TIMER1_COMPA_vect)
       
     } else {
       // Segment buffer empty. Shutdown.
+      #ifdef DIAGNOSTIC_COUNTERS
+        // Running out of segments with a planner block still in preparation is an underrun. The
+        // feed hold runs the buffer empty on purpose.
+        if ((sys.state == STATE_CYCLE) && (pl_block != NULL)) { diag.underrun++; }
+      #endif
+      #ifdef LASER_MOTION_SYNC
+        // Apply laser changes queued after the last motion, but not at a feed hold.
+        if (!plan_get_current_block()) { laser_apply(laser_target); }
+      #endif
+      #ifdef LDR_READ_QUEUE
+        // All reads are due once the queued motions are done, but not at a feed hold.
+        if (!plan_get_current_block()) { ldr_read_latch(ldr_read_head); }
+      #endif
       st_go_idle();
       bit_true_atomic(sys.execute,EXEC_CYCLE_STOP); // Flag main program for cycle end
       return; // Nothing to do but exit.
@@ -365,8 +560,31 @@ ISR(TIMER1_COMPA_vect)
   
   
   // Check probing state.
-  probe_state_monitor();
+  #ifdef PROBE_PIN_INTERRUPT
+    // The probe pin interrupt leaves the latch to this tick when it triggered during the last one.
+    if (sys.probe_state == PROBE_LATCH) { probe_latch_position(); }
+  #else
+    probe_state_monitor();
+  #endif
    
+#ifdef SINGLE_AXIS_STEPPER
+  // With a single axis, every tick is a step. The segment timing is the step rate of the axis,
+  // so there is no line to trace.
+  st.step_outbits = (1<<X_STEP_BIT);
+  if (st.exec_block->direction_bits & (1<<X_DIRECTION_BIT)) { sys.position[X_AXIS]--; }
+  else { sys.position[X_AXIS]++; }
+  #ifdef LDR_STREAMING
+    ldr_stream_step();
+  #endif
+  #ifdef CAMERA_TRIGGER
+    if (st.trigger_interval) {
+      if (++st.trigger_count == st.trigger_interval) {
+        st.trigger = true;
+        st.trigger_count = 0;
+      }
+    }
+  #endif
+#else
   // Reset step out bits.
   st.step_outbits = 0; 
 
@@ -381,6 +599,17 @@ ISR(TIMER1_COMPA_vect)
     st.counter_x -= st.exec_block->step_event_count;
     if (st.exec_block->direction_bits & (1<<X_DIRECTION_BIT)) { sys.position[X_AXIS]--; }
     else { sys.position[X_AXIS]++; }
+    #ifdef LDR_STREAMING
+      ldr_stream_step();
+    #endif
+    #ifdef CAMERA_TRIGGER
+      if (st.trigger_interval) {
+        if (++st.trigger_count == st.trigger_interval) {
+          st.trigger = true;
+          st.trigger_count = 0;
+        }
+      }
+    #endif
   }
   #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
     st.counter_y += st.steps[Y_AXIS];
@@ -404,18 +633,30 @@ ISR(TIMER1_COMPA_vect)
     if (st.exec_block->direction_bits & (1<<Z_DIRECTION_BIT)) { sys.position[Z_AXIS]--; }
     else { sys.position[Z_AXIS]++; }*/
   }  
+#endif
 
   // During a homing cycle, lock out and prevent desired axes from moving.
   if (sys.state == STATE_HOMING) { st.step_outbits &= sys.homing_axis_lock; }   
 
   st.step_count--; // Decrement step events count 
   if (st.step_count == 0) {
+    #ifdef CAMERA_TRIGGER
+      // Planner block is complete with this step. Trigger, if not counting steps.
+      if (st.exec_segment->end_of_block && !st.trigger_interval) { st.trigger = true; }
+    #endif
     // Segment is complete. Discard current segment and advance segment indexing.
     st.exec_segment = NULL;
     if ( ++segment_buffer_tail == SEGMENT_BUFFER_SIZE) { segment_buffer_tail = 0; }
   }
 
   st.step_outbits ^= step_port_invert_mask;  // Apply step port invert mask    
+
+  #ifdef DIAGNOSTIC_COUNTERS
+    diag.isr_count++;
+    if (entry_cycles > diag.isr_entry_max) { diag.isr_entry_max = entry_cycles; }
+    diag.isr_cycles = st_timer1_cycles(TCNT1);
+    if (diag.isr_cycles > diag.isr_cycles_max) { diag.isr_cycles_max = diag.isr_cycles; }
+  #endif
   busy = false;
 // SPINDLE_ENABLE_PORT ^= 1<<SPINDLE_ENABLE_BIT; // Debug: Used to time ISR
 }
@@ -436,6 +677,9 @@ ISR(TIMER0_OVF_vect)
 {
   // Reset stepping pins (leave the direction pins)
   STEP_PORT = (STEP_PORT & ~STEP_MASK) | (step_port_invert_mask & STEP_MASK); 
+  #ifdef CAMERA_TRIGGER
+    TRIGGER_PORT &= ~TRIGGER_MASK; // Reset camera trigger pin
+  #endif
   TCCR0B = 0; // Disable Timer0 to prevent re-entering this interrupt when it's not needed. 
 }
 #ifdef STEP_PULSE_DELAY
@@ -497,6 +741,10 @@ void stepper_init()
   STEP_DDR |= STEP_MASK;
   STEPPERS_DISABLE_DDR |= 1<<STEPPERS_DISABLE_BIT;
   DIRECTION_DDR |= DIRECTION_MASK;
+  #ifdef CAMERA_TRIGGER
+    TRIGGER_DDR |= TRIGGER_MASK;
+    TRIGGER_PORT &= ~TRIGGER_MASK;
+  #endif
 
   // Configure Timer 1: Stepper Driver Interrupt
   TCCR1B &= ~(1<<WGM13); // waveform generation = 0100 = CTC
@@ -514,15 +762,172 @@ void stepper_init()
   #ifdef STEP_PULSE_DELAY
     TIMSK0 |= (1<<OCIE0A); // Enable Timer0 Compare Match A interrupt
   #endif
+
+  #ifdef RAMP_TABLE
+    st_update_ramp_table();
+  #endif
 }
   
 
+// Loads the Bresenham data of a new planner block into the next stepper block of the segment prep.
+static void st_prep_load_block()
+{
+  // Increment stepper common data index to store new planner block data. 
+  if ( ++prep.st_block_index == (SEGMENT_BUFFER_SIZE-1) ) { prep.st_block_index = 0; }
+  
+  // Prepare and copy Bresenham algorithm segment data from the new planner block, so that
+  // when the segment buffer completes the planner block, it may be discarded when the 
+  // segment buffer finishes the prepped block, but the stepper ISR is still executing it. 
+  st_prep_block = &st_block_buffer[prep.st_block_index];
+  st_prep_block->direction_bits = pl_block->direction_bits;
+  #ifdef LASER_MOTION_SYNC
+    st_prep_block->laser_state = pl_block->laser_state;
+  #endif
+  #ifdef LDR_READ_QUEUE
+    st_prep_block->ldr_read_mark = pl_block->ldr_read_mark;
+  #endif
+  #if defined(SINGLE_AXIS_STEPPER)
+    // Nothing else to copy. The segment step counts are the steps of the lone axis.
+  #elif !defined(ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING)
+    st_prep_block->steps[X_AXIS] = pl_block->steps[X_AXIS];
+    st_prep_block->steps[Y_AXIS] = pl_block->steps[Y_AXIS];
+    st_prep_block->steps[Z_AXIS] = pl_block->steps[Z_AXIS];
+    st_prep_block->step_event_count = pl_block->step_event_count;
+  #else
+    // With AMASS enabled, simply bit-shift multiply all Bresenham data by the max AMASS 
+    // level, such that we never divide beyond the original data anywhere in the algorithm.
+    // If the original data is divided, we can lose a step from integer roundoff.
+    st_prep_block->steps[X_AXIS] = pl_block->steps[X_AXIS] << MAX_AMASS_LEVEL;
+    st_prep_block->steps[Y_AXIS] = pl_block->steps[Y_AXIS] << MAX_AMASS_LEVEL;
+    st_prep_block->steps[Z_AXIS] = pl_block->steps[Z_AXIS] << MAX_AMASS_LEVEL;
+    st_prep_block->step_event_count = pl_block->step_event_count << MAX_AMASS_LEVEL;
+  #endif
+}
+
+
+// Sets the step timing of a prepped segment from its CPU cycles per step.
+static void st_prep_segment_timing(segment_t *prep_segment, uint32_t cycles)
+{
+  #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING        
+    // Compute step timing and multi-axis smoothing level.
+    // NOTE: AMASS overdrives the timer with each level, so only one prescalar is required.
+    if (cycles < AMASS_LEVEL1) { prep_segment->amass_level = 0; }
+    else {
+      if (cycles < AMASS_LEVEL2) { prep_segment->amass_level = 1; }
+      else if (cycles < AMASS_LEVEL3) { prep_segment->amass_level = 2; }
+      else { prep_segment->amass_level = 3; }    
+      cycles >>= prep_segment->amass_level; 
+      prep_segment->n_step <<= prep_segment->amass_level;
+    }
+    if (cycles < (1UL << 16)) { prep_segment->cycles_per_tick = cycles; } // < 65536 (4.1ms @ 16MHz)
+    else { prep_segment->cycles_per_tick = 0xffff; } // Just set the slowest speed possible.
+  #else 
+    // Compute step timing and timer prescalar for normal step generation.
+    if (cycles < (1UL << 16)) { // < 65536  (4.1ms @ 16MHz)
+      prep_segment->prescaler = 1; // prescaler: 0
+      prep_segment->cycles_per_tick = cycles;
+    } else if (cycles < (1UL << 19)) { // < 524288 (32.8ms@16MHz)
+      prep_segment->prescaler = 2; // prescaler: 8
+      prep_segment->cycles_per_tick = cycles >> 3;
+    } else { 
+      prep_segment->prescaler = 3; // prescaler: 64
+      if (cycles < (1UL << 22)) { // < 4194304 (262ms@16MHz)
+        prep_segment->cycles_per_tick =  cycles >> 6;
+      } else { // Just set the slowest speed possible. (Around 4 step/sec.)
+        prep_segment->cycles_per_tick = 0xffff;
+      }
+    }
+  #endif
+}
+
+
+#ifdef FIXED_POINT_PLANNER
+  // Converts a speed in (step/sec) to prep speed units. Speeds are capped at PLAN_MAX_SPEED, so the
+  // shift never overflows.
+  static uint32_t st_prep_speed(uint32_t step_rate)
+  {
+    return((step_rate << PREP_SPEED_BITS)/ACCELERATION_TICKS_PER_SECOND);
+  }
+
+
+  // Converts a speed in prep speed units back to (step/sec).
+  static uint32_t st_prep_step_rate(uint32_t speed)
+  {
+    return((speed*ACCELERATION_TICKS_PER_SECOND) >> PREP_SPEED_BITS);
+  }
+
+
+  // Returns the speed change of one segment in prep speed units at the acceleration (step/sec^2).
+  // Divided in two parts to keep the shift within 32 bits. A non-zero increment always makes
+  // progress on the ramps.
+  static uint32_t st_prep_speed_increment(uint32_t acceleration)
+  {
+    uint32_t accel_var = acceleration/PREP_SEGMENTS_PER_SEC_SQR;
+    uint32_t speed_increment = (accel_var << PREP_SPEED_BITS) +
+            ((acceleration-accel_var*PREP_SEGMENTS_PER_SEC_SQR) << PREP_SPEED_BITS)/PREP_SEGMENTS_PER_SEC_SQR;
+    return(max(speed_increment, 1));
+  }
+
+
+  // Returns the CPU cycles per step of a segment from the sum of its start and end speeds. The sum
+  // is shifted down to keep the division in 32 bits:
+  // cycles = PREP_CYCLES_PER_SEGMENT*2^(PREP_SPEED_BITS+1)/segment_speed.
+  static uint32_t st_prep_cycles(uint32_t segment_speed)
+  {
+    segment_speed >>= PREP_SPEED_BITS+1-12;
+    if (segment_speed == 0) { return(0xffffffff); } // Just set the slowest speed possible.
+    return((PREP_CYCLES_PER_SEGMENT << 12)/segment_speed);
+  }
+
+
+  #ifdef RAMP_TABLE
+    // Returns the CPU cycles per step of a segment like st_prep_cycles(), from the ramp table. Sums
+    // on the increments are exact. Others interpolate between the neighboring entries, where 1/x
+    // is close to linear, or are divided near zero speed and past the table.
+    static uint32_t st_ramp_table_cycles(uint32_t segment_speed)
+    {
+      if ((segment_speed >= ramp_table.speed_limit) || (prep.speed_increment != ramp_table.speed_increment)) {
+        return(st_prep_cycles(segment_speed));
+      }
+      // The rounded down inverse finds the entry or the one before it. Never more below 2^24.
+      uint8_t index = (segment_speed*ramp_table.inverse_increment) >> RAMP_TABLE_SHIFT;
+      uint32_t remainder = segment_speed - index*ramp_table.speed_increment;
+      if (remainder >= ramp_table.speed_increment) {
+        index++;
+        remainder -= ramp_table.speed_increment;
+      }
+      if (remainder == 0) { return(ramp_table.cycles[index]); }
+      if (index < RAMP_TABLE_INTERPOLATION_MIN) { return(st_prep_cycles(segment_speed)); }
+      // Interpolate in 1/256 of an increment. The entries decrease and are at most 2^22.
+      uint32_t fraction = (remainder*ramp_table.inverse_increment) >> (RAMP_TABLE_SHIFT-8);
+      return(ramp_table.cycles[index] - (((ramp_table.cycles[index]-ramp_table.cycles[index+1])*fraction) >> 8));
+    }
+  #endif
+
+
+  // Returns the distance in substeps to change the speed squared by delta_speed_sqr (step/sec)^2 at
+  // the acceleration (step/sec^2). Saturates beyond any block distance.
+  static uint32_t st_prep_ramp_distance(uint32_t delta_speed_sqr, uint32_t acceleration)
+  {
+    uint32_t accel_2 = 2*acceleration;
+    uint32_t steps = delta_speed_sqr/accel_2;
+    if (steps >= (1UL << (32-PREP_SUBSTEP_BITS))) { return(0xffffffff); }
+    return( (steps << PREP_SUBSTEP_BITS) + ((delta_speed_sqr-steps*accel_2) << PREP_SUBSTEP_BITS)/accel_2 );
+  }
+#endif
+
+
 // Called by planner_recalculate() when the executing block is updated by the new plan.
 void st_update_plan_block_parameters()
 { 
   if (pl_block != NULL) { // Ignore if at start of a new block.
     prep.flag_partial_block = true;
-    pl_block->entry_speed_sqr = prep.current_speed*prep.current_speed; // Update entry speed.
+    #ifdef FIXED_POINT_PLANNER
+      uint32_t entry_speed = st_prep_step_rate(prep.current_speed);
+      pl_block->entry_speed_sqr = entry_speed*entry_speed; // Update entry speed.
+    #else
+      pl_block->entry_speed_sqr = prep.current_speed*prep.current_speed; // Update entry speed.
+    #endif
     pl_block = NULL; // Flag st_prep_segment() to load new velocity profile.
   }
 }
@@ -541,6 +946,322 @@ void st_update_plan_block_parameters()
    Currently, the segment buffer conservatively holds roughly up to 40-50 msec of steps.
    NOTE: Computation units are in steps, degrees, and minutes.
 */
+#ifdef FIXED_POINT_PLANNER
+// Fixed-point version for the single X axis. Traces the same velocity profiles in integer substeps
+// and segment speed increments, without any float math or square roots per segment.
+void st_prep_buffer()
+{
+  while (segment_buffer_tail != segment_next_head) { // Check if we need to fill the buffer.
+
+    // Determine if we need to load a new planner block or if the block has been replanned.
+    if (pl_block == NULL) {
+      pl_block = plan_get_current_block(); // Query planner for a queued block
+      if (pl_block == NULL) { return; } // No planner blocks. Exit.
+
+      // Check if the segment buffer completed the last planner block. If so, load the Bresenham
+      // data for the block. If not, we are still mid-block and the velocity profile was updated.
+      if (prep.flag_partial_block) {
+        prep.flag_partial_block = false; // Reset flag
+      } else {
+        st_prep_load_block();
+
+        // Initialize segment buffer data for generating the segments. Nothing of a block is
+        // executed before it is loaded, so its remaining steps are all of its steps.
+        prep.substeps_remaining = pl_block->steps_remaining << PREP_SUBSTEP_BITS;
+
+        if ((sys.state == STATE_HOLD) || prep.flag_decel_override) {
+          // Override planner block entry speed and enforce deceleration during feed hold.
+          // Also continues a feed override deceleration that did not complete in the last block.
+          prep.flag_decel_override = false;
+          prep.current_speed = prep.exit_speed;
+          uint32_t entry_speed = st_prep_step_rate(prep.exit_speed);
+          pl_block->entry_speed_sqr = entry_speed*entry_speed;
+        }
+        else { prep.current_speed = st_prep_speed(isqrt(pl_block->entry_speed_sqr)); }
+      }
+
+      uint32_t acceleration = plan_block_acceleration(pl_block);
+      uint32_t nominal_speed_sqr = plan_block_nominal_speed_sqr(pl_block);
+
+      prep.speed_increment = st_prep_speed_increment(acceleration);
+
+      /* ---------------------------------------------------------------------------------
+         Compute the velocity profile of a new planner block based on its entry and exit
+         speeds, or recompute the profile of a partially-completed planner block if the
+         planner has updated it. For a commanded forced-deceleration, such as from a feed
+         hold, override the planner velocities and decelerate to the target exit speed.
+      */
+      uint32_t distance = prep.substeps_remaining;
+      prep.substeps_complete = 0; // Default velocity profile complete at the end of block.
+      prep.accelerate_until = 0;
+      prep.decelerate_after = 0;
+      if (sys.state == STATE_HOLD) { // [Forced Deceleration to Zero Velocity]
+        // Compute velocity profile parameters for a feed hold in-progress. This profile overrides
+        // the planner block profile, enforcing a deceleration to zero speed.
+        prep.ramp_type = RAMP_DECEL;
+        uint32_t decel_dist = st_prep_ramp_distance(pl_block->entry_speed_sqr, acceleration);
+        if (decel_dist < distance) {
+          // End of feed hold. Truncated to a step, so the hold stops on a whole step.
+          prep.substeps_complete = (distance-decel_dist) & ~((1UL << PREP_SUBSTEP_BITS)-1);
+          prep.exit_speed = 0;
+        } else {
+          // Deceleration through entire planner block. End of feed hold is not in this block.
+          uint32_t speed_sqr_var = 2*acceleration*(distance >> PREP_SUBSTEP_BITS);
+          if (speed_sqr_var < pl_block->entry_speed_sqr) {
+            prep.exit_speed = st_prep_speed(isqrt(pl_block->entry_speed_sqr-speed_sqr_var));
+          } else {
+            prep.exit_speed = 0;
+          }
+        }
+      } else { // [Normal Operation]
+        // Compute or recompute velocity profile parameters of the prepped planner block.
+        prep.ramp_type = RAMP_ACCEL; // Initialize as acceleration ramp.
+        uint32_t exit_speed = plan_get_exec_block_exit_speed();
+        uint32_t exit_speed_sqr = exit_speed*exit_speed;
+        prep.exit_speed = st_prep_speed(exit_speed);
+
+        if (pl_block->entry_speed_sqr > nominal_speed_sqr) {
+          // Entered above the nominal speed. Only occurs after a feed override reduction. Decelerate
+          // to the reduced speed, then continue as a cruise-deceleration profile.
+          uint32_t ramp_dist = st_prep_ramp_distance(pl_block->entry_speed_sqr-nominal_speed_sqr, acceleration);
+          prep.decelerate_after = st_prep_ramp_distance(nominal_speed_sqr-exit_speed_sqr, acceleration);
+          if ((prep.decelerate_after < distance) && (ramp_dist < distance-prep.decelerate_after)) {
+            prep.ramp_type = RAMP_DECEL_OVERRIDE;
+            prep.accelerate_until = distance-ramp_dist;
+            prep.maximum_speed = st_prep_speed(isqrt(nominal_speed_sqr));
+          } else {
+            // Too short to reach the reduced speed. Decelerate through the whole block and enter
+            // the next one at the resulting exit speed, which is never below the planned one.
+            prep.ramp_type = RAMP_DECEL;
+            prep.decelerate_after = 0;
+            uint32_t speed_sqr_var = 2*acceleration*(distance >> PREP_SUBSTEP_BITS);
+            if (speed_sqr_var < pl_block->entry_speed_sqr-exit_speed_sqr) {
+              prep.exit_speed = st_prep_speed(isqrt(pl_block->entry_speed_sqr-speed_sqr_var));
+              prep.flag_decel_override = true;
+            }
+          }
+        } else {
+          // Distance from end of block to the intersection of the entry acceleration and exit
+          // deceleration ramps. Zero for acceleration-only and the distance for deceleration-only.
+          uint32_t intersect_distance;
+          if (pl_block->entry_speed_sqr > exit_speed_sqr) {
+            uint32_t ramp_dist = st_prep_ramp_distance(pl_block->entry_speed_sqr-exit_speed_sqr, acceleration);
+            if (ramp_dist < distance) { intersect_distance = ramp_dist+(distance-ramp_dist)/2; }
+            else { intersect_distance = distance; }
+          } else {
+            uint32_t ramp_dist = st_prep_ramp_distance(exit_speed_sqr-pl_block->entry_speed_sqr, acceleration);
+            if (ramp_dist < distance) { intersect_distance = (distance-ramp_dist)/2; }
+            else { intersect_distance = 0; }
+          }
+
+          if (intersect_distance > 0) {
+            if (intersect_distance < distance) { // Either trapezoid or triangle types
+              // NOTE: For acceleration-cruise and cruise-only types, following calculation will be 0.
+              prep.decelerate_after = st_prep_ramp_distance(nominal_speed_sqr-exit_speed_sqr, acceleration);
+              if (prep.decelerate_after < intersect_distance) { // Trapezoid type
+                prep.maximum_speed = st_prep_speed(isqrt(nominal_speed_sqr));
+                if (pl_block->entry_speed_sqr == nominal_speed_sqr) {
+                  // Cruise-deceleration or cruise-only type.
+                  prep.ramp_type = RAMP_CRUISE;
+                } else {
+                  // Full-trapezoid or acceleration-cruise types
+                  // NOTE: Kept at or after the deceleration start against round-off.
+                  uint32_t ramp_dist = st_prep_ramp_distance(nominal_speed_sqr-pl_block->entry_speed_sqr, acceleration);
+                  prep.accelerate_until = prep.decelerate_after;
+                  if (ramp_dist < distance-prep.decelerate_after) { prep.accelerate_until = distance-ramp_dist; }
+                }
+              } else { // Triangle type
+                prep.accelerate_until = intersect_distance;
+                prep.decelerate_after = intersect_distance;
+                uint32_t accel_2 = 2*acceleration;
+                uint32_t maximum_speed_sqr = exit_speed_sqr + accel_2*(intersect_distance >> PREP_SUBSTEP_BITS) +
+                        ((accel_2*(intersect_distance & ((1UL << PREP_SUBSTEP_BITS)-1))) >> PREP_SUBSTEP_BITS);
+                prep.maximum_speed = st_prep_speed(isqrt(min(maximum_speed_sqr, nominal_speed_sqr)));
+              }
+            } else { // Deceleration-only type
+              prep.ramp_type = RAMP_DECEL;
+              prep.maximum_speed = prep.current_speed;
+            }
+          } else { // Acceleration-only type
+            prep.maximum_speed = prep.exit_speed;
+          }
+        }
+      }
+    }
+
+    // Initialize new segment
+    segment_t *prep_segment = &segment_buffer[segment_buffer_head];
+
+    // Set new segment to point to the current segment data block.
+    prep_segment->st_block_index = prep.st_block_index;
+
+    /*------------------------------------------------------------------------------------
+        Advance the velocity profile by one segment time per loop. A segment ends early at a
+      ramp junction or at the end of the profile, and is extended by more segment times when
+      it would not execute a whole step. Every segment time changes the speed by the constant
+      speed increment on the ramps and travels the average speed of the segment time.
+    */
+    uint32_t substeps_remaining = prep.substeps_remaining; // Segment distance from end of block.
+    uint32_t segment_speed = prep.current_speed; // Sum of the segment start and end speeds
+    uint32_t last_n_steps_remaining = (substeps_remaining+(1UL << PREP_SUBSTEP_BITS)-1) >> PREP_SUBSTEP_BITS;
+    uint32_t n_steps_remaining;
+    uint32_t speed_var; // Speed worker variable
+    uint32_t substep_var; // Substep-distance worker variable
+    do {
+      switch (prep.ramp_type) {
+        case RAMP_ACCEL:
+          speed_var = prep.current_speed + prep.speed_increment;
+          substep_var = (prep.current_speed + speed_var) >> PREP_DISTANCE_SHIFT;
+          if (substep_var < substeps_remaining - prep.accelerate_until) {
+            substeps_remaining -= substep_var;
+            if (speed_var < prep.maximum_speed) { // Acceleration only.
+              prep.current_speed = speed_var;
+              break;
+            }
+            // Reached the maximum speed before the ramp end by round-off. Cruise from here.
+            prep.ramp_type = RAMP_CRUISE;
+          } else { // End of acceleration ramp.
+            // Acceleration-cruise, acceleration-deceleration ramp junction, or end of block.
+            substeps_remaining = prep.accelerate_until; // NOTE: 0 at EOB
+            if (substeps_remaining == prep.decelerate_after) { prep.ramp_type = RAMP_DECEL; }
+            else { prep.ramp_type = RAMP_CRUISE; }
+          }
+          prep.current_speed = prep.maximum_speed;
+          break;
+        case RAMP_DECEL_OVERRIDE:
+          if (prep.current_speed > prep.maximum_speed+prep.speed_increment) {
+            speed_var = prep.current_speed - prep.speed_increment;
+            substep_var = (prep.current_speed + speed_var) >> PREP_DISTANCE_SHIFT;
+            if (substep_var < substeps_remaining - prep.accelerate_until) { // Deceleration only.
+              substeps_remaining -= substep_var;
+              prep.current_speed = speed_var;
+              break;
+            }
+          }
+          // End of override deceleration ramp. Cruise at the reduced speed.
+          substeps_remaining = prep.accelerate_until;
+          prep.ramp_type = RAMP_CRUISE;
+          prep.current_speed = prep.maximum_speed;
+          break;
+        case RAMP_CRUISE:
+          // NOTE: Enforce a minimum distance, so slow cruises with round-off still make progress.
+          substep_var = max(prep.maximum_speed >> (PREP_SPEED_BITS-PREP_SUBSTEP_BITS), 1);
+          if (substep_var < substeps_remaining - prep.decelerate_after) { // Cruising only.
+            substeps_remaining -= substep_var;
+          } else { // End of cruise.
+            // Cruise-deceleration junction or end of block.
+            substeps_remaining = prep.decelerate_after; // NOTE: 0 at EOB
+            prep.ramp_type = RAMP_DECEL;
+          }
+          break;
+        default: // case RAMP_DECEL:
+          if (prep.current_speed > prep.speed_increment) { // Check if at or below zero speed.
+            speed_var = prep.current_speed - prep.speed_increment;
+            substep_var = (prep.current_speed + speed_var) >> PREP_DISTANCE_SHIFT;
+            if (substep_var < substeps_remaining - prep.substeps_complete) { // Deceleration only.
+              substeps_remaining -= substep_var;
+              prep.current_speed = speed_var;
+              break; // Segment time complete. Exit switch-case statement. Continue do-while loop.
+            }
+          } // End of block or end of forced-deceleration.
+          substeps_remaining = prep.substeps_complete;
+          prep.current_speed = prep.exit_speed;
+      }
+      n_steps_remaining = (substeps_remaining+(1UL << PREP_SUBSTEP_BITS)-1) >> PREP_SUBSTEP_BITS;
+      // Loop through segment times until a whole step or the end of the profile is reached.
+    } while (n_steps_remaining == last_n_steps_remaining && substeps_remaining > prep.substeps_complete);
+    segment_speed += prep.current_speed;
+
+    /* -----------------------------------------------------------------------------------
+       Compute segment step rate and steps to execute. Steps are the difference of the whole
+       steps remaining, rounded up, so no step is ever lost to round-off. The rate is the
+       average of the segment start and end speeds.
+    */
+    prep_segment->n_step = last_n_steps_remaining-n_steps_remaining; // Compute number of steps to execute.
+
+    // Bail if we are at the end of a feed hold and don't have a step to execute.
+    if (prep_segment->n_step == 0) {
+      if (sys.state == STATE_HOLD) {
+        // Less than one step to decelerate to zero speed, but already very close. AMASS
+        // requires full steps to execute. So, just bail.
+        prep.current_speed = 0;
+        prep.substeps_remaining = last_n_steps_remaining << PREP_SUBSTEP_BITS;
+        pl_block->steps_remaining = last_n_steps_remaining; // Update with full steps.
+        plan_cycle_reinitialize();
+        sys.state = STATE_QUEUED;
+        return; // Segment not generated, but current step data still retained.
+      }
+    }
+
+    // Compute CPU cycles per step for the prepped segment.
+    #ifdef RAMP_TABLE
+      st_prep_segment_timing(prep_segment, st_ramp_table_cycles(segment_speed));
+    #else
+      st_prep_segment_timing(prep_segment, st_prep_cycles(segment_speed));
+    #endif
+
+    #ifdef CAMERA_TRIGGER
+      // Flag the segment that completes the planner block. Feed holds also end here, but leave
+      // distance remaining in the block and do not trigger.
+      prep_segment->end_of_block = (substeps_remaining == 0);
+    #endif
+
+    // Segment complete! Increment segment buffer indices.
+    segment_buffer_head = segment_next_head;
+    if ( ++segment_next_head == SEGMENT_BUFFER_SIZE ) { segment_next_head = 0; }
+
+    // Setup initial conditions for next segment.
+    prep.substeps_remaining = substeps_remaining;
+    pl_block->steps_remaining = n_steps_remaining;
+    if (substeps_remaining == prep.substeps_complete) {
+      // End of planner block or forced-termination. No more distance to be executed.
+      if (substeps_remaining > 0) { // At end of forced-termination.
+        // Reset prep parameters for resuming and then bail.
+        // NOTE: Currently only feed holds qualify for this scenario. May change with overrides.
+        prep.current_speed = 0;
+        plan_cycle_reinitialize();
+        sys.state = STATE_QUEUED; // End cycle.
+        return; // Bail!
+      } else { // End of planner block
+        // The planner block is complete. All steps are set to be executed in the segment buffer.
+        pl_block = NULL;
+        plan_discard_current_block();
+      }
+    }
+  }
+}
+#else
+#ifdef S_CURVE_ACCELERATION
+  // Starts an S-curve ramp from the current speed to end_speed at the block acceleration, at
+  // start_deg from the end of the block.
+  static void st_prep_start_ramp(float end_speed, float start_deg)
+  {
+    prep.ramp_start_speed = prep.current_speed;
+    prep.ramp_delta_speed = end_speed-prep.current_speed;
+    prep.ramp_start_deg = start_deg;
+    prep.ramp_duration = fabs(prep.ramp_delta_speed)/pl_block->acceleration;
+    prep.ramp_time = 0.0;
+  }
+
+
+  // Returns the S-curve ramp speed at the ramp time. Only valid until the ramp duration.
+  static float st_prep_ramp_speed()
+  {
+    float u = prep.ramp_time/prep.ramp_duration;
+    return(prep.ramp_start_speed + prep.ramp_delta_speed*u*u*(3.0-2.0*u));
+  }
+
+
+  // Returns the distance from the end of block at the ramp time, the ramp start less the integral
+  // of the ramp speed. Only valid until the ramp duration.
+  static float st_prep_ramp_deg_remaining()
+  {
+    float u = prep.ramp_time/prep.ramp_duration;
+    return(prep.ramp_start_deg - prep.ramp_time*(prep.ramp_start_speed + prep.ramp_delta_speed*u*u*(1.0-0.5*u)));
+  }
+#endif
+
+
 void st_prep_buffer()
 {
   while (segment_buffer_tail != segment_next_head) { // Check if we need to fill the buffer.
@@ -555,29 +1276,8 @@ void st_prep_buffer()
       if (prep.flag_partial_block) {
         prep.flag_partial_block = false; // Reset flag
       } else {
-        // Increment stepper common data index to store new planner block data. 
-        if ( ++prep.st_block_index == (SEGMENT_BUFFER_SIZE-1) ) { prep.st_block_index = 0; }
-        
-        // Prepare and copy Bresenham algorithm segment data from the new planner block, so that
-        // when the segment buffer completes the planner block, it may be discarded when the 
-        // segment buffer finishes the prepped block, but the stepper ISR is still executing it. 
-        st_prep_block = &st_block_buffer[prep.st_block_index];
-        st_prep_block->direction_bits = pl_block->direction_bits;
-        #ifndef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
-          st_prep_block->steps[X_AXIS] = pl_block->steps[X_AXIS];
-          st_prep_block->steps[Y_AXIS] = pl_block->steps[Y_AXIS];
-          st_prep_block->steps[Z_AXIS] = pl_block->steps[Z_AXIS];
-          st_prep_block->step_event_count = pl_block->step_event_count;
-        #else
-          // With AMASS enabled, simply bit-shift multiply all Bresenham data by the max AMASS 
-          // level, such that we never divide beyond the original data anywhere in the algorithm.
-          // If the original data is divided, we can lose a step from integer roundoff.
-          st_prep_block->steps[X_AXIS] = pl_block->steps[X_AXIS] << MAX_AMASS_LEVEL;
-          st_prep_block->steps[Y_AXIS] = pl_block->steps[Y_AXIS] << MAX_AMASS_LEVEL;
-          st_prep_block->steps[Z_AXIS] = pl_block->steps[Z_AXIS] << MAX_AMASS_LEVEL;
-          st_prep_block->step_event_count = pl_block->step_event_count << MAX_AMASS_LEVEL;
-        #endif
-        
+        st_prep_load_block();
+
         // Initialize segment buffer data for generating the segments.
         prep.steps_remaining = pl_block->step_event_count;
         prep.step_per_deg = prep.steps_remaining/pl_block->degrees;
@@ -585,8 +1285,10 @@ void st_prep_buffer()
         
         prep.dt_remainder = 0.0; // Reset for new planner block
 
-        if (sys.state == STATE_HOLD) {
+        if ((sys.state == STATE_HOLD) || prep.flag_decel_override) {
           // Override planner block entry speed and enforce deceleration during feed hold.
+          // Also continues a feed override deceleration that did not complete in the last block.
+          prep.flag_decel_override = false;
           prep.current_speed = prep.exit_speed; 
           pl_block->entry_speed_sqr = prep.exit_speed*prep.exit_speed; 
         }
@@ -622,7 +1324,26 @@ void st_prep_buffer()
         float exit_speed_sqr = prep.exit_speed*prep.exit_speed;
         float intersect_distance =
                 0.5*(pl_block->degrees+inv_2_accel*(pl_block->entry_speed_sqr-exit_speed_sqr));
-        if (intersect_distance > 0.0) {
+        if (pl_block->entry_speed_sqr > pl_block->nominal_speed_sqr) {
+          // Entered above the nominal speed. Only occurs after a feed override reduction. Decelerate
+          // to the reduced speed, then continue as a cruise-deceleration profile.
+          prep.accelerate_until -= inv_2_accel*(pl_block->entry_speed_sqr-pl_block->nominal_speed_sqr);
+          prep.decelerate_after = inv_2_accel*(pl_block->nominal_speed_sqr-exit_speed_sqr);
+          if (prep.accelerate_until > prep.decelerate_after) {
+            prep.ramp_type = RAMP_DECEL_OVERRIDE;
+            prep.maximum_speed = sqrt(pl_block->nominal_speed_sqr);
+          } else {
+            // Too short to reach the reduced speed. Decelerate through the whole block and enter
+            // the next one at the resulting exit speed, which is never below the planned one.
+            prep.ramp_type = RAMP_DECEL;
+            prep.maximum_speed = prep.current_speed;
+            float exit_speed_sqr_var = pl_block->entry_speed_sqr-2*pl_block->acceleration*pl_block->degrees;
+            if (exit_speed_sqr_var > exit_speed_sqr) {
+              prep.exit_speed = sqrt(exit_speed_sqr_var);
+              prep.flag_decel_override = true;
+            }
+          }
+        } else if (intersect_distance > 0.0) {
           if (intersect_distance < pl_block->degrees) { // Either trapezoid or triangle types
             // NOTE: For acceleration-cruise and cruise-only types, following calculation will be 0.0.
             prep.decelerate_after = inv_2_accel*(pl_block->nominal_speed_sqr-exit_speed_sqr);
@@ -651,6 +1372,12 @@ void st_prep_buffer()
           prep.maximum_speed = prep.exit_speed;
         }
       }  
+
+      #ifdef S_CURVE_ACCELERATION
+        // Start the first ramp of the profile. Nothing to ramp for a cruise.
+        if (prep.ramp_type == RAMP_DECEL) { st_prep_start_ramp(prep.exit_speed, pl_block->degrees); }
+        else { st_prep_start_ramp(prep.maximum_speed, pl_block->degrees); }
+      #endif
     }
 
     // Initialize new segment
@@ -677,7 +1404,9 @@ void st_prep_buffer()
     float dt = 0.0; // Initialize segment time
     float time_var = dt_max; // Time worker variable
     float deg_var; // deg-Distance worker variable
-    float speed_var; // Speed worker variable   
+    #ifndef S_CURVE_ACCELERATION // The S-curve ramps compute the speed from the ramp time.
+      float speed_var; // Speed worker variable   
+    #endif
     float deg_remaining = pl_block->degrees; // New segment distance from end of block.
     float minimum_deg = deg_remaining-prep.req_deg_increment; // Guarantee at least one step.
     if (minimum_deg < 0.0) { minimum_deg = 0.0; }
@@ -686,17 +1415,68 @@ void st_prep_buffer()
       switch (prep.ramp_type) {
         case RAMP_ACCEL: 
           // NOTE: Acceleration ramp only computes during first do-while loop.
-          speed_var = pl_block->acceleration*time_var;
-          deg_remaining -= time_var*(prep.current_speed + 0.5*speed_var);
+          #ifdef S_CURVE_ACCELERATION
+            if (prep.ramp_time+time_var < prep.ramp_duration) {
+              prep.ramp_time += time_var;
+              deg_remaining = st_prep_ramp_deg_remaining();
+            } else { // Ramp time complete. End the ramp at its junction after the remaining ramp time.
+              time_var = prep.ramp_duration-prep.ramp_time;
+              deg_remaining = -1.0;
+            }
+          #else
+            speed_var = pl_block->acceleration*time_var;
+            deg_remaining -= time_var*(prep.current_speed + 0.5*speed_var);
+          #endif
           if (deg_remaining < prep.accelerate_until) { // End of acceleration ramp.
             // Acceleration-cruise, acceleration-deceleration ramp junction, or end of block.
             deg_remaining = prep.accelerate_until; // NOTE: 0.0 at EOB
-            time_var = 2.0*(pl_block->degrees-deg_remaining)/(prep.current_speed+prep.maximum_speed);
-            if (deg_remaining == prep.decelerate_after) { prep.ramp_type = RAMP_DECEL; }
-            else { prep.ramp_type = RAMP_CRUISE; }
+            #ifndef S_CURVE_ACCELERATION // Otherwise the ramp time sets the segment time.
+              time_var = 2.0*(pl_block->degrees-deg_remaining)/(prep.current_speed+prep.maximum_speed);
+            #endif
             prep.current_speed = prep.maximum_speed;
+            if (deg_remaining == prep.decelerate_after) {
+              prep.ramp_type = RAMP_DECEL;
+              #ifdef S_CURVE_ACCELERATION
+                st_prep_start_ramp(prep.exit_speed, deg_remaining);
+              #endif
+            }
+            else { prep.ramp_type = RAMP_CRUISE; }
           } else { // Acceleration only. 
-            prep.current_speed += speed_var;
+            #ifdef S_CURVE_ACCELERATION
+              prep.current_speed = st_prep_ramp_speed();
+            #else
+              prep.current_speed += speed_var;
+            #endif
+          }
+          break;
+        case RAMP_DECEL_OVERRIDE:
+          // NOTE: Like the acceleration ramp, only computes during first do-while loop.
+          #ifdef S_CURVE_ACCELERATION
+            if (prep.ramp_time+time_var < prep.ramp_duration) {
+              prep.ramp_time += time_var;
+              deg_remaining = st_prep_ramp_deg_remaining();
+            } else {
+              time_var = prep.ramp_duration-prep.ramp_time;
+              deg_remaining = -1.0;
+            }
+          #else
+            speed_var = pl_block->acceleration*time_var;
+            deg_remaining -= time_var*(prep.current_speed - 0.5*speed_var);
+          #endif
+          if (deg_remaining < prep.accelerate_until) { // End of override deceleration ramp.
+            // Cruise at the reduced speed.
+            deg_remaining = prep.accelerate_until;
+            #ifndef S_CURVE_ACCELERATION
+              time_var = 2.0*(pl_block->degrees-deg_remaining)/(prep.current_speed+prep.maximum_speed);
+            #endif
+            prep.ramp_type = RAMP_CRUISE;
+            prep.current_speed = prep.maximum_speed;
+          } else { // Deceleration only.
+            #ifdef S_CURVE_ACCELERATION
+              prep.current_speed = st_prep_ramp_speed();
+            #else
+              prep.current_speed -= speed_var;
+            #endif
           }
           break;
         case RAMP_CRUISE: 
@@ -709,22 +1489,38 @@ void st_prep_buffer()
             time_var = (deg_remaining - prep.decelerate_after)/prep.maximum_speed;
             deg_remaining = prep.decelerate_after; // NOTE: 0.0 at EOB
             prep.ramp_type = RAMP_DECEL;
+            #ifdef S_CURVE_ACCELERATION
+              st_prep_start_ramp(prep.exit_speed, deg_remaining);
+            #endif
           } else { // Cruising only.         
             deg_remaining = deg_var; 
           } 
           break;
         default: // case RAMP_DECEL:
           // NOTE: deg_var used as a misc worker variable to prevent errors when near zero speed.
-          speed_var = pl_block->acceleration*time_var; // Used as delta speed (deg/min)
-          if (prep.current_speed > speed_var) { // Check if at or below zero speed.
-            // Compute distance from end of segment to end of block.
-            deg_var = deg_remaining - time_var*(prep.current_speed - 0.5*speed_var); // (deg)
-            if (deg_var > prep.deg_complete) { // Deceleration only.
-              deg_remaining = deg_var;
-              prep.current_speed -= speed_var;
-              break; // Segment complete. Exit switch-case statement. Continue do-while loop.
+          #ifdef S_CURVE_ACCELERATION
+            if (prep.ramp_time+time_var < prep.ramp_duration) { // Check if at the end of the ramp.
+              prep.ramp_time += time_var;
+              deg_var = st_prep_ramp_deg_remaining();
+              if (deg_var > prep.deg_complete) { // Deceleration only.
+                deg_remaining = deg_var;
+                prep.current_speed = st_prep_ramp_speed();
+                break; // Segment complete. Exit switch-case statement. Continue do-while loop.
+              }
             }
-          } // End of block or end of forced-deceleration.
+          #else
+            speed_var = pl_block->acceleration*time_var; // Used as delta speed (deg/min)
+            if (prep.current_speed > speed_var) { // Check if at or below zero speed.
+              // Compute distance from end of segment to end of block.
+              deg_var = deg_remaining - time_var*(prep.current_speed - 0.5*speed_var); // (deg)
+              if (deg_var > prep.deg_complete) { // Deceleration only.
+                deg_remaining = deg_var;
+                prep.current_speed -= speed_var;
+                break; // Segment complete. Exit switch-case statement. Continue do-while loop.
+              }
+            }
+          #endif
+          // End of block or end of forced-deceleration.
           time_var = 2.0*(deg_remaining-prep.deg_complete)/(prep.current_speed+prep.exit_speed);
           deg_remaining = prep.deg_complete; 
       }
@@ -789,35 +1585,12 @@ void st_prep_buffer()
     // Compute CPU cycles per step for the prepped segment.
     uint32_t cycles = ceil( (TICKS_PER_MICROSECOND*1000000*60)*inv_rate ); // (cycles/step)    
 
-    #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING        
-      // Compute step timing and multi-axis smoothing level.
-      // NOTE: AMASS overdrives the timer with each level, so only one prescalar is required.
-      if (cycles < AMASS_LEVEL1) { prep_segment->amass_level = 0; }
-      else {
-        if (cycles < AMASS_LEVEL2) { prep_segment->amass_level = 1; }
-        else if (cycles < AMASS_LEVEL3) { prep_segment->amass_level = 2; }
-        else { prep_segment->amass_level = 3; }    
-        cycles >>= prep_segment->amass_level; 
-        prep_segment->n_step <<= prep_segment->amass_level;
-      }
-      if (cycles < (1UL << 16)) { prep_segment->cycles_per_tick = cycles; } // < 65536 (4.1ms @ 16MHz)
-      else { prep_segment->cycles_per_tick = 0xffff; } // Just set the slowest speed possible.
-    #else 
-      // Compute step timing and timer prescalar for normal step generation.
-      if (cycles < (1UL << 16)) { // < 65536  (4.1ms @ 16MHz)
-        prep_segment->prescaler = 1; // prescaler: 0
-        prep_segment->cycles_per_tick = cycles;
-      } else if (cycles < (1UL << 19)) { // < 524288 (32.8ms@16MHz)
-        prep_segment->prescaler = 2; // prescaler: 8
-        prep_segment->cycles_per_tick = cycles >> 3;
-      } else { 
-        prep_segment->prescaler = 3; // prescaler: 64
-        if (cycles < (1UL << 22)) { // < 4194304 (262ms@16MHz)
-          prep_segment->cycles_per_tick =  cycles >> 6;
-        } else { // Just set the slowest speed possible. (Around 4 step/sec.)
-          prep_segment->cycles_per_tick = 0xffff;
-        }
-      }
+    st_prep_segment_timing(prep_segment, cycles);
+
+    #ifdef CAMERA_TRIGGER
+      // Flag the segment that completes the planner block. Feed holds also end here, but leave
+      // distance remaining in the block and do not trigger.
+      prep_segment->end_of_block = !(deg_remaining > 0.0);
     #endif
 
     // Segment complete! Increment segment buffer indices.
@@ -853,6 +1626,27 @@ void st_prep_buffer()
 
   } 
 }      
+#endif
+
+
+#ifdef RAMP_TABLE
+  // Rebuilds the ramp table for the acceleration setting. A speed increment too large for the
+  // fixed-point lookup leaves the table unused.
+  void st_update_ramp_table()
+  {
+    uint32_t speed_increment = st_prep_speed_increment(plan_compute_acceleration());
+    ramp_table.speed_increment = speed_increment;
+    ramp_table.inverse_increment = (1UL << RAMP_TABLE_SHIFT)/speed_increment;
+    ramp_table.speed_limit = 0;
+    if (speed_increment < (1UL << RAMP_TABLE_SHIFT)/(RAMP_TABLE_SIZE-1)) {
+      ramp_table.speed_limit = (RAMP_TABLE_SIZE-1)*speed_increment;
+    }
+    uint16_t index;
+    for (index = 0; index < RAMP_TABLE_SIZE; index++) {
+      ramp_table.cycles[index] = min(st_prep_cycles(index*speed_increment), RAMP_TABLE_MAX_CYCLES);
+    }
+  }
+#endif
 
 
 // Called by runtime status reporting to fetch the current speed being executed. This value
@@ -863,8 +1657,25 @@ void st_prep_buffer()
   float st_get_realtime_rate()
   {
      if (sys.state & (STATE_CYCLE | STATE_HOMING | STATE_HOLD)){
-       return prep.current_speed;
+       #ifdef FIXED_POINT_PLANNER
+         return (st_prep_step_rate(prep.current_speed)*60.0/settings.steps_per_deg[X_AXIS]);
+       #else
+         return prep.current_speed;
+       #endif
      }
     return 0.0f;
   }
 #endif
+
+
+#ifdef STEP_TRACE
+  void st_trace_report()
+  {
+    uint8_t idx = (st_trace_head + STEP_TRACE_SIZE - st_trace_count) % STEP_TRACE_SIZE; // Oldest record
+    while (st_trace_count) {
+      report_step_trace(st_trace_buffer[idx].time, st_trace_buffer[idx].position);
+      if (++idx == STEP_TRACE_SIZE) { idx = 0; }
+      st_trace_count--;
+    }
+  }
+#endif
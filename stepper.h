@@ -55,9 +55,19 @@ void st_prep_buffer();
 // Called by planner_recalculate() when the executing block is updated by the new plan.
 void st_update_plan_block_parameters();
 
+// Rebuilds the segment prep ramp table. Called when the X steps/deg or acceleration setting changes.
+#ifdef RAMP_TABLE
+void st_update_ramp_table();
+#endif
+
 // Called by runtime status reporting if realtime rate reporting is enabled in config.h.
 #ifdef REPORT_REALTIME_RATE
 float st_get_realtime_rate();
 #endif
 
+#ifdef STEP_TRACE
+  // Sends the trace records, oldest first, and clears the trace. Called when idle only.
+  void st_trace_report();
+#endif
+
 #endif
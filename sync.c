@@ -0,0 +1,71 @@
+/*
+  sync.c - sync bus between scanner units
+  Part of Horus Firmware
+
+  Copyright (c) 2014-2015 Mundo Reader S.L.
+
+  Horus Firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Horus Firmware is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Horus Firmware.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "system.h"
+#include "sync.h"
+
+#ifdef SYNC_BUS
+
+void sync_init()
+{
+  sync_disarm();
+  SYNC_OUT_DDR |= SYNC_OUT_MASK;
+  SYNC_IN_DDR &= ~SYNC_IN_MASK;
+  SYNC_IN_PORT |= SYNC_IN_MASK; // Enable internal pull-up resistor. The input idles high.
+  SYNC_PCMSK |= SYNC_IN_MASK;
+  PCICR |= (1 << SYNC_INT);
+}
+
+
+// NOTE: The armed flag and the output change together with interrupts disabled. Otherwise an edge
+// in between could leave the output high with nothing armed. The output port may also not be
+// bit-addressable, such as PORTL on the Mega, so its read-modify-write must not be interrupted.
+void sync_arm()
+{
+  uint8_t sreg = SREG;
+  cli();
+  bit_false(sys.execute, EXEC_CYCLE_START); // A cycle start from before the sync point doesn't release it.
+  sys.sync_armed = true;
+  SYNC_OUT_PORT |= SYNC_OUT_MASK; // Signal that this unit reached the sync point.
+  SREG = sreg;
+}
+
+
+void sync_disarm()
+{
+  uint8_t sreg = SREG;
+  cli();
+  sys.sync_armed = false;
+  SYNC_OUT_PORT &= ~SYNC_OUT_MASK;
+  SREG = sreg;
+}
+
+
+// Sync input pin change interrupt. A falling edge releases the armed motion at once. The rising
+// edge and edges while nothing is armed are ignored.
+ISR(SYNC_INT_vect)
+{
+  if (sys.sync_armed && !(SYNC_IN_PIN & SYNC_IN_MASK)) {
+    sync_disarm();
+    bit_true(sys.execute, EXEC_CYCLE_START);
+  }
+}
+
+#endif
@@ -0,0 +1,35 @@
+/*
+  sync.h - sync bus between scanner units
+  Part of Horus Firmware
+
+  Copyright (c) 2014-2015 Mundo Reader S.L.
+
+  Horus Firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Horus Firmware is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Horus Firmware.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef sync_h
+#define sync_h
+
+
+// Configures the sync pins. The output is low and nothing is armed.
+void sync_init();
+
+// Raises the sync output and holds the queued motions until the next falling edge on the sync
+// input, which lowers the output and starts the cycle.
+void sync_arm();
+
+// Releases the sync point and lowers the output. Called by the edge and by any cycle start.
+void sync_disarm();
+
+#endif
@@ -29,6 +29,7 @@
 #include "motion_control.h"
 #include "report.h"
 #include "print.h"
+#include "stepper.h"
 
 
 void system_init() 
@@ -65,17 +66,142 @@ void system_execute_startup(char *line)
   uint8_t n;
   for (n=0; n < N_STARTUP_LINE; n++) {
     if (!(settings_read_startup_line(n, line))) {
-      report_status_message(STATUS_SETTING_READ_FAIL);
+      report_unsolicited_status(STATUS_SETTING_READ_FAIL);
     } else {
       if (line[0] != 0) {
         printString(line); // Echo startup line to indicate execution.
-        report_status_message(gc_execute_line(line));
+        report_unsolicited_status(gc_execute_line(line)); // Not a response to a host line.
       }
     } 
   }  
 }
 
 
+// Parses and runs the on-board scan sequence '$S'. Words are X (step, deg), L (step count),
+// F (feed rate, deg/sec), T (laser frame pattern), P (exposure dwell per frame, sec) and, with
+// SYNC_BUS, W (1 holds each step for the sync input edge). The pattern is a digit string, one
+// laser number per frame and 0 for an all lasers off frame. The feed rate defaults to the parser
+// feed rate and the pattern to a single lasers off frame.
+static uint8_t system_execute_scan(char *line, uint8_t char_counter)
+{
+  char pattern[SCAN_MAX_FRAMES+1] = "0";
+  float step = 0.0, count = 0.0, feed_rate = gc_state.feed_rate, exposure = 0.0;
+  float value;
+  uint8_t frame, sync = false;
+  char letter;
+
+  while (line[char_counter] != 0) {
+    letter = line[char_counter++];
+    if (letter == 'T') {
+      // Read as characters so a leading 0 frame is kept.
+      frame = 0;
+      while ((line[char_counter] >= '0') && (line[char_counter] <= ('0'+N_LASER))) {
+        if (frame == SCAN_MAX_FRAMES) { return(STATUS_INVALID_STATEMENT); }
+        pattern[frame++] = line[char_counter++];
+      }
+      if (!frame) { return(STATUS_BAD_NUMBER_FORMAT); }
+      pattern[frame] = 0;
+      continue;
+    }
+    if (!read_float(line, &char_counter, &value)) { return(STATUS_BAD_NUMBER_FORMAT); }
+    switch (letter) {
+      case 'X': step = value; break;
+      case 'L': count = value; break;
+      case 'F': feed_rate = value*60; break; // Convert deg/sec to deg/min
+      case 'P': exposure = value; break;
+      #ifdef SYNC_BUS
+        case 'W': sync = (value != 0.0); break;
+      #endif
+      default: return(STATUS_INVALID_STATEMENT);
+    }
+  }
+
+  if ((count < 0.0) || (feed_rate < 0.0) || (exposure < 0.0)) { return(STATUS_NEGATIVE_VALUE); }
+  if ((step == 0.0) || (count < 1.0) || (count > 0xFFFF)) { return(STATUS_INVALID_STATEMENT); }
+  if (feed_rate == 0.0) { return(STATUS_GCODE_UNDEFINED_FEED_RATE); }
+
+  mc_scan_cycle(step, trunc(count), feed_rate, pattern, exposure, sync);
+  return(STATUS_OK);
+}
+
+
+// Parses and queues the move list '$M'. X is a comma-separated list of absolute targets, in work
+// degrees like G90 G1, and I a list of relative moves, repeated L times. F sets the feed rate in
+// deg/sec, which stays the parser feed rate as with a g-code F word. The whole line is checked
+// before the first move is queued, so an error queues nothing.
+static uint8_t system_execute_move_list(char *line, uint8_t char_counter)
+{
+  float count = 1.0, feed_rate = gc_state.feed_rate;
+  float value;
+  uint8_t list = 0, relative = false;
+  char letter;
+
+  while (line[char_counter] != 0) {
+    letter = line[char_counter++];
+    if ((letter == 'X') || (letter == 'I')) {
+      if (list) { return(STATUS_GCODE_WORD_REPEATED); }
+      list = char_counter;
+      relative = (letter == 'I');
+      do {
+        if (!read_float(line, &char_counter, &value)) { return(STATUS_BAD_NUMBER_FORMAT); }
+      } while ((line[char_counter] == ',') && ++char_counter);
+      continue;
+    }
+    if (!read_float(line, &char_counter, &value)) { return(STATUS_BAD_NUMBER_FORMAT); }
+    switch (letter) {
+      case 'L': count = value; break;
+      case 'F': feed_rate = value*60; break; // Convert deg/sec to deg/min
+      default: return(STATUS_INVALID_STATEMENT);
+    }
+  }
+
+  if (!list) { return(STATUS_GCODE_NO_AXIS_WORDS); }
+  if ((count < 0.0) || (feed_rate < 0.0)) { return(STATUS_NEGATIVE_VALUE); }
+  if ((count < 1.0) || (count > 0xFFFF) || (!relative && (count != 1.0))) { return(STATUS_INVALID_STATEMENT); }
+  if (feed_rate == 0.0) { return(STATUS_GCODE_UNDEFINED_FEED_RATE); }
+
+  gc_state.feed_rate = feed_rate;
+  gc_state.modal.motion = MOTION_MODE_LINEAR;
+  if (relative) {
+    char_counter = list;
+    read_float(line, &char_counter, &value);
+    if (line[char_counter] != ',') { // A single move repeated, such as a scan step.
+      mc_line_repeat(value, trunc(count), feed_rate);
+      return(STATUS_OK);
+    }
+  }
+  uint16_t n;
+  for (n=trunc(count); n>0; n--) {
+    char_counter = list;
+    do {
+      read_float(line, &char_counter, &value);
+      if (!relative) { // Queued as the relative move from the parser position to the target.
+        value += gc_state.coord_system[X_AXIS] + gc_state.coord_offset[X_AXIS] - gc_state.position[X_AXIS];
+        if (TOOL_LENGTH_OFFSET_AXIS == X_AXIS) { value += gc_state.tool_length_offset; }
+      }
+      mc_line_repeat(value, 1, feed_rate);
+      if (sys.abort) { return(STATUS_OK); }
+    } while (line[char_counter++] == ',');
+  }
+  return(STATUS_OK);
+}
+
+
+// Parses and runs the continuous rotation jog '$J'. The F word sets the rate in deg/sec, negative
+// to turn backwards, and starts the jog or changes its rate. Without F, or with F0, the jog stops.
+static uint8_t system_execute_jog(char *line, uint8_t char_counter)
+{
+  float rate = 0.0;
+  if (line[char_counter] != 0) {
+    if (line[char_counter++] != 'F') { return(STATUS_INVALID_STATEMENT); }
+    if (!read_float(line, &char_counter, &rate)) { return(STATUS_BAD_NUMBER_FORMAT); }
+    if (line[char_counter] != 0) { return(STATUS_INVALID_STATEMENT); }
+  }
+  mc_jog(rate*60); // Convert deg/sec to deg/min
+  return(STATUS_OK);
+}
+
+
 // Directs and executes one line of formatted input from protocol_process. While mostly
 // incoming streaming g-code blocks, this also executes Grbl internal commands, such as 
 // settings, initiating the homing cycle, and toggling switch states. This differs from
@@ -100,6 +226,12 @@ uint8_t system_execute_line(char *line)
       if ( line[++char_counter] != 0 ) { return(STATUS_INVALID_STATEMENT); }
       else { report_gcode_modes(); }
       break;   
+    #ifdef DIAGNOSTIC_COUNTERS
+      case 'D' : // Prints and clears diagnostic counters. Allowed during a cycle.
+        if ( line[++char_counter] != 0 ) { return(STATUS_INVALID_STATEMENT); }
+        else { report_diagnostics(); }
+        break;
+    #endif
     case 'C' : // Set check g-code mode [IDLE/CHECK]
       if ( line[++char_counter] != 0 ) { return(STATUS_INVALID_STATEMENT); }
       // Perform reset when toggling off. Check g-code mode should only work if Grbl
@@ -122,18 +254,13 @@ uint8_t system_execute_line(char *line)
         // Don't run startup script. Prevents stored moves in startup from causing accidents.
       } // Otherwise, no effect.
       break;               
-//  case 'J' : break;  // Jogging methods
-    // TODO: Here jogging can be placed for execution as a seperate subprogram. It does not need to be 
-    // susceptible to other runtime commands except for e-stop. The jogging function is intended to
-    // be a basic toggle on/off with controlled acceleration and deceleration to prevent skipped 
-    // steps. The user would supply the desired feedrate, axis to move, and direction. Toggle on would
-    // start motion and toggle off would initiate a deceleration to stop. One could 'feather' the
-    // motion by repeatedly toggling to slow the motion to the desired location. Location data would 
-    // need to be updated real-time and supplied to the user through status queries.
-    //   More controlled exact motions can be taken care of by inputting G0 or G1 commands, which are 
-    // handled by the planner. It would be possible for the jog subprogram to insert blocks into the
-    // block buffer without having the planner plan them. It would need to manage de/ac-celerations 
-    // on its own carefully. This approach could be effective and possibly size/memory efficient.        
+    case 'M' : // Queue a move list. Like a g-code line, not in alarm or during a jog.
+      if (sys.state == STATE_ALARM) { return(STATUS_ALARM_LOCK); }
+      if (sys.jog_rate != 0.0) { return(STATUS_IDLE_ERROR); }
+      return(system_execute_move_list(line, ++char_counter));
+    case 'J' : // Start, change or stop continuous rotation jog. [IDLE/JOG]
+      if ( !(sys.state == STATE_IDLE || sys.jog_rate != 0.0) ) { return(STATUS_IDLE_ERROR); }
+      return(system_execute_jog(line, ++char_counter));
     default : 
       // Block any system command that requires the state as IDLE/ALARM. (i.e. EEPROM, homing)
       if ( !(sys.state == STATE_IDLE || sys.state == STATE_ALARM) ) { return(STATUS_IDLE_ERROR); }
@@ -145,7 +272,7 @@ uint8_t system_execute_line(char *line)
         case 'H' : // Perform homing cycle [IDLE/ALARM]
           if (bit_istrue(settings.flags,BITFLAG_HOMING_ENABLE)) { 
             // Only perform homing if Grbl is idle or lost.
-            /*mc_homing_cycle();*/
+            mc_homing_cycle();
             if (!sys.abort) { system_execute_startup(line); } // Execute startup scripts after successful homing.
           } else { return(STATUS_SETTING_DISABLED); }
           break;
@@ -162,11 +289,20 @@ uint8_t system_execute_line(char *line)
             settings_store_build_info(line);
           }
           break;                 
+        #ifdef STEP_TRACE
+          case 'T' : // Dump step trace records. [IDLE/ALARM]
+            if ( line[++char_counter] != 0 ) { return(STATUS_INVALID_STATEMENT); }
+            else { st_trace_report(); }
+            break;
+        #endif
+        case 'S' : // Run scan sequence. [IDLE Only] Prevents motion during ALARM.
+          if (sys.state != STATE_IDLE) { return(STATUS_IDLE_ERROR); }
+          return(system_execute_scan(line, ++char_counter));
         case 'N' : // Startup lines. [IDLE/ALARM]
           if ( line[++char_counter] == 0 ) { // Print startup lines
             for (helper_var=0; helper_var < N_STARTUP_LINE; helper_var++) {
               if (!(settings_read_startup_line(helper_var, line))) {
-                report_status_message(STATUS_SETTING_READ_FAIL);
+                report_unsolicited_status(STATUS_SETTING_READ_FAIL);
               } else {
                 report_startup_line(helper_var,line);
               }
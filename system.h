@@ -58,7 +58,7 @@
 #define EXEC_RESET          bit(4) // bitmask 00010000
 #define EXEC_ALARM          bit(5) // bitmask 00100000
 #define EXEC_CRIT_EVENT     bit(6) // bitmask 01000000
-// #define                  bit(7) // bitmask 10000000
+#define EXEC_FEED_OVERRIDE  bit(7) // bitmask 10000000
 
 // Define system state bit map. The state variable primarily tracks the individual functions
 // of Grbl to manage each without overlapping. It is also used as a messaging flag for
@@ -84,9 +84,42 @@ typedef struct {
   uint8_t auto_start;            // Planner auto-start flag. Toggled off during feed hold. Defaulted by settings.
   volatile uint8_t probe_state;   // Probing state value.  Used to coordinate the probing cycle with stepper ISR.
   int32_t probe_position[N_AXIS]; // Last probe position in machine coordinates and steps.
+  #ifdef PROBE_PIN_INTERRUPT
+    uint32_t probe_time;          // Time of the last probe edge in usec since power-up.
+  #endif
+  volatile uint8_t f_override;    // Feed override in percent. Set by the serial interrupt.
+  float jog_rate;                 // Continuous rotation jog rate in deg/min. Negative turns backwards,
+                                  // zero when not jogging.
+  #ifdef SYNC_BUS
+    volatile uint8_t sync_armed;  // Queued motions wait for the sync input edge. Cleared by its interrupt.
+  #endif
 } system_t;
 extern system_t sys;
 
+#ifdef DIAGNOSTIC_COUNTERS
+  // Conversion time of the LDR ADC interrupt, the timebase of the loop times: 13 ADC clock
+  // cycles at a 128 prescaler.
+  #define DIAG_TICK_USEC ((13UL*128UL*1000000UL)/F_CPU)
+
+  // Define interrupt and buffer health counters. Cleared after every '$D' report.
+  typedef struct {
+    uint32_t isr_count;        // Stepper interrupt calls
+    uint16_t isr_entry_max;    // Worst stepper interrupt entry latency in CPU cycles
+    uint16_t isr_cycles;       // Last stepper interrupt cycles from the compare match to its exit, entry latency included
+    uint16_t isr_cycles_max;   // Worst stepper interrupt cycles from the compare match to its exit
+    uint16_t isr_overrun;      // Stepper interrupts skipped, since the previous one was still busy
+    uint16_t underrun;         // Segment buffer ran empty while the planner block was being prepared
+    uint8_t planner_max;       // Planner buffer high-water mark in blocks
+    uint8_t rx_max;            // Serial RX buffer high-water mark in bytes
+    uint8_t tx_max;            // Serial TX buffer high-water mark in bytes
+    uint16_t loop_time;        // Last main program loop time in ticks
+    uint16_t loop_time_max;    // Worst main program loop time in ticks
+    uint16_t loop_tick;        // Tick of the last runtime checkpoint
+    volatile uint16_t tick;    // Free running tick count. Incremented by the ADC interrupt.
+  } diag_t;
+  extern diag_t diag;
+#endif
+
 
 // Initialize the serial protocol
 void system_init();
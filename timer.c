@@ -0,0 +1,112 @@
+/*
+  timer.c - millisecond software timers on Timer2
+  Part of Horus Firmware
+
+  Copyright (c) 2014-2015 Mundo Reader S.L.
+
+  Horus Firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Horus Firmware is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Horus Firmware.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "system.h"
+#include "timer.h"
+
+// Timers keep their next expiry as a deadline on the millisecond count. The interrupt only compares
+// the count with the earliest deadline, and looks at the timers when that one is due.
+typedef struct {
+  uint32_t deadline;           // Millisecond count of the next expiry
+  uint32_t period;             // Milliseconds between expiries. Zero for one-shot.
+  timer_callback_t callback;
+} timer_slot_t;
+
+static timer_slot_t timer_slot[N_TIMER];
+static volatile uint8_t timer_running; // Bit n is set while timer n runs.
+static volatile uint8_t timer_flags;   // Bit n is set when timer n expired.
+static uint32_t timer_ms;              // Milliseconds since power-up
+static uint32_t timer_next;            // Earliest deadline of the running timers
+
+// Deadlines are compared as differences, so the millisecond count may wrap around.
+#define timer_due(deadline) ((int32_t)(timer_ms-(deadline)) >= 0)
+
+
+void timer_init()
+{
+  uint8_t sreg = SREG;
+  cli();
+  timer_running = 0;
+  timer_flags = 0;
+  SREG = sreg;
+}
+
+
+void timer_start(uint8_t id, uint32_t ms, uint32_t period, timer_callback_t callback)
+{
+  if (id >= N_TIMER) { return; }
+  if (!ms) { ms = 1; }
+  uint8_t sreg = SREG;
+  cli();
+  timer_slot[id].deadline = timer_ms+ms;
+  timer_slot[id].period = period;
+  timer_slot[id].callback = callback;
+  // A stale earliest deadline only costs one extra look at the timers.
+  if (!timer_running || ((int32_t)(timer_slot[id].deadline-timer_next) < 0)) { timer_next = timer_slot[id].deadline; }
+  timer_running |= bit(id);
+  timer_flags &= ~bit(id);
+  SREG = sreg;
+}
+
+
+void timer_stop(uint8_t id)
+{
+  if (id >= N_TIMER) { return; }
+  uint8_t sreg = SREG;
+  cli();
+  timer_running &= ~bit(id);
+  timer_flags &= ~bit(id);
+  SREG = sreg;
+}
+
+
+uint8_t timer_active(uint8_t id) { return(bit_istrue(timer_running,bit(id))); }
+
+
+uint8_t timer_expired(uint8_t id)
+{
+  if (bit_isfalse(timer_flags,bit(id))) { return(false); }
+  bit_false_atomic(timer_flags,bit(id));
+  return(true);
+}
+
+
+void timer_tick()
+{
+  timer_ms++;
+  if (!timer_running || !timer_due(timer_next)) { return; }
+
+  // Expire the due timers, then find the earliest deadline of the ones still running.
+  uint8_t id;
+  for (id=0; id<N_TIMER; id++) {
+    if (bit_isfalse(timer_running,bit(id)) || !timer_due(timer_slot[id].deadline)) { continue; }
+    if (timer_slot[id].period) { timer_slot[id].deadline += timer_slot[id].period; }
+    else { timer_running &= ~bit(id); }
+    timer_flags |= bit(id);
+    if (timer_slot[id].callback) { timer_slot[id].callback(id); }
+  }
+  int32_t next = INT32_MAX;
+  for (id=0; id<N_TIMER; id++) {
+    if (bit_isfalse(timer_running,bit(id))) { continue; }
+    int32_t delta = timer_slot[id].deadline-timer_ms;
+    if (delta < next) { next = delta; }
+  }
+  timer_next = timer_ms+next;
+}
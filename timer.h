@@ -0,0 +1,55 @@
+/*
+  timer.h - millisecond software timers on Timer2
+  Part of Horus Firmware
+
+  Copyright (c) 2014-2015 Mundo Reader S.L.
+
+  Horus Firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Horus Firmware is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Horus Firmware.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef timer_h
+#define timer_h
+
+// Software timers, ticked every millisecond by the Timer2 interrupt. Each timer belongs to one
+// module. On expiry, its expired flag is set for the main program, and its callback, if any, is
+// called from the Timer2 interrupt.
+#define TIMER_LASER          0 // Laser safety timeouts, one per laser (TIMER_LASER+id).
+#define TIMER_DWELL          (TIMER_LASER+N_LASER) // Dwell of mc_dwell()
+#define TIMER_STATUS_REPORT  (TIMER_DWELL+1) // Status report push interval
+#define N_TIMER              (TIMER_STATUS_REPORT+1) // Must be 8 or less.
+
+// Called from the Timer2 interrupt with the id of the expired timer. Must be short, interrupts
+// are disabled.
+typedef void (*timer_callback_t)(uint8_t id);
+
+// Stops all timers. Called on power-up and system reset.
+void timer_init();
+
+// Starts the timer to expire in ms milliseconds (1 or more), and then again every period
+// milliseconds unless period is zero. Restarts a running timer and clears its expired flag.
+void timer_start(uint8_t id, uint32_t ms, uint32_t period, timer_callback_t callback);
+
+// Stops the timer and clears its expired flag.
+void timer_stop(uint8_t id);
+
+// Returns true while the timer is running. A one-shot timer stops as it expires.
+uint8_t timer_active(uint8_t id);
+
+// Returns true, and clears the flag, if the timer expired since the last call.
+uint8_t timer_expired(uint8_t id);
+
+// Advances the timers one millisecond. Called by the Timer2 interrupt only.
+void timer_tick();
+
+#endif